@@ -53,8 +53,15 @@ void testApp::setup(){
 	timeline.setLoopType(OF_LOOP_NORMAL);
     
 	//each call to "add keyframes" add's another track to the timeline
+	//the first curves track builds the easing previews that every other curves track shares,
+	//so adding the second one is much faster
+	unsigned long long addStart = ofGetElapsedTimeMicros();
 	timeline.addCurves("Rotate X", ofRange(0, 360));
+	unsigned long long firstCurvesMicros = ofGetElapsedTimeMicros() - addStart;
+	addStart = ofGetElapsedTimeMicros();
 	timeline.addCurves("Rotate Y", ofRange(0, 360));
+	unsigned long long secondCurvesMicros = ofGetElapsedTimeMicros() - addStart;
+	ofLogNotice("testApp") << "first curves track took " << firstCurvesMicros << "us, second took " << secondCurvesMicros << "us";
     
 	//Flags are little markers that you can attach text to
     //They are only useful when listening to bangFired() events
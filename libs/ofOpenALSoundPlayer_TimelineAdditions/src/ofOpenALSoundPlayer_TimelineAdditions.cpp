@@ -11,6 +11,12 @@
 #include <math.h>
 #endif
 
+// SSE2 is always there on x86_64, everything else runs the plan's scalar loops
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FFT_PLAN_SSE
+#include <emmintrin.h>
+#endif
+
 ALCdevice * ofOpenALSoundPlayer_TimelineAdditions::alDevice = 0;
 ALCcontext * ofOpenALSoundPlayer_TimelineAdditions::alContext = 0;
 //vector<float> ofOpenALSoundPlayer_TimelineAdditions::window;
@@ -29,6 +35,314 @@ void ofOpenALSoundUpdate_TimelineAdditions(){
 }
 
 #define BUFFER_STREAM_SIZE 4096
+#define WINDOW_CHUNK_FRAMES 65536
+#define WINDOW_CHUNKS 4
+
+// ----------------------------------------------------------------------------
+ofSoundFileWindow_TimelineAdditions::ofSoundFileWindow_TimelineAdditions(){
+	file		= 0;
+	channels	= 0;
+	frames		= 0;
+	samplerate	= 0;
+	useCount	= 0;
+}
+
+// ----------------------------------------------------------------------------
+ofSoundFileWindow_TimelineAdditions::~ofSoundFileWindow_TimelineAdditions(){
+	close();
+}
+
+// ----------------------------------------------------------------------------
+bool ofSoundFileWindow_TimelineAdditions::open(string path){
+	close();
+	SF_INFO sfInfo;
+	sfInfo.format = 0;
+	file = sf_open(path.c_str(),SFM_READ,&sfInfo);
+	if(!file){
+		ofLog(OF_LOG_ERROR,"ofSoundFileWindow_TimelineAdditions: couldnt read " + path);
+		return false;
+	}
+
+	// let libsndfile normalize float files to the same range as the decoded buffer
+	int subformat = sfInfo.format & SF_FORMAT_SUBMASK;
+	if(subformat == SF_FORMAT_FLOAT || subformat == SF_FORMAT_DOUBLE){
+		sf_command(file, SFC_SET_SCALE_FLOAT_INT_READ, NULL, SF_TRUE);
+	}
+
+	channels = sfInfo.channels;
+	frames = sfInfo.frames;
+	samplerate = sfInfo.samplerate;
+	chunks.resize(WINDOW_CHUNKS);
+	for(int i=0;i<(int)chunks.size();i++){
+		chunks[i].index = -1;
+		chunks[i].lastUsed = 0;
+		chunks[i].samples.resize(WINDOW_CHUNK_FRAMES*channels);
+	}
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+void ofSoundFileWindow_TimelineAdditions::close(){
+	mutex.lock();
+	if(file){
+		sf_close(file);
+		file = 0;
+	}
+	chunks.clear();
+	channels = 0;
+	frames = 0;
+	samplerate = 0;
+	mutex.unlock();
+}
+
+// ----------------------------------------------------------------------------
+bool ofSoundFileWindow_TimelineAdditions::isOpen(){
+	return file != 0;
+}
+
+// ----------------------------------------------------------------------------
+int ofSoundFileWindow_TimelineAdditions::getNumChannels(){
+	return channels;
+}
+
+// ----------------------------------------------------------------------------
+long ofSoundFileWindow_TimelineAdditions::getNumFrames(){
+	return frames;
+}
+
+// ----------------------------------------------------------------------------
+int ofSoundFileWindow_TimelineAdditions::getSampleRate(){
+	return samplerate;
+}
+
+// ----------------------------------------------------------------------------
+ofSoundFileWindow_TimelineAdditions::Chunk & ofSoundFileWindow_TimelineAdditions::getChunk(long index){
+	// reuse the chunk if it's cached, otherwise decode over the least recently used one
+	int oldest = 0;
+	for(int i=0;i<(int)chunks.size();i++){
+		if(chunks[i].index == index){
+			chunks[i].lastUsed = ++useCount;
+			return chunks[i];
+		}
+		if(chunks[i].lastUsed < chunks[oldest].lastUsed){
+			oldest = i;
+		}
+	}
+
+	Chunk & chunk = chunks[oldest];
+	sf_count_t frames_read = 0;
+	if(sf_seek(file,index*WINDOW_CHUNK_FRAMES,SEEK_SET) >= 0){
+		frames_read = sf_readf_short(file,&chunk.samples[0],WINDOW_CHUNK_FRAMES);
+	}
+	if(frames_read < 0) frames_read = 0;
+	for(int i=frames_read*channels;i<(int)chunk.samples.size();i++){
+		chunk.samples[i] = 0;
+	}
+	chunk.index = index;
+	chunk.lastUsed = ++useCount;
+	return chunk;
+}
+
+// ----------------------------------------------------------------------------
+void ofSoundFileWindow_TimelineAdditions::readFrames(long startFrame, int count, short * out){
+	mutex.lock();
+	int frame = 0;
+	while(frame < count){
+		long fileFrame = startFrame + frame;
+		if(!file || fileFrame < 0 || fileFrame >= frames){
+			for(int i=0;i<channels;i++){
+				out[frame*channels+i] = 0;
+			}
+			frame++;
+			continue;
+		}
+
+		// copy everything this chunk holds in one go
+		Chunk & chunk = getChunk(fileFrame / WINDOW_CHUNK_FRAMES);
+		int offset = fileFrame % WINDOW_CHUNK_FRAMES;
+		int run = MIN(WINDOW_CHUNK_FRAMES - offset, count - frame);
+		memcpy(&out[frame*channels], &chunk.samples[offset*channels], run*channels*sizeof(short));
+		frame += run;
+	}
+	mutex.unlock();
+}
+
+// ----------------------------------------------------------------------------
+ofFFTAnalyzer_TimelineAdditions::ofFFTAnalyzer_TimelineAdditions(){
+	fftCfg			= 0;
+	bands			= 0;
+	samplerate		= 0;
+	minBandwidth	= 0;
+	bandsPerOctave	= 0;
+	normalizer		= 0;
+}
+
+// ----------------------------------------------------------------------------
+ofFFTAnalyzer_TimelineAdditions::~ofFFTAnalyzer_TimelineAdditions(){
+	if(fftCfg!=0) kiss_fftr_free(fftCfg);
+}
+
+// ----------------------------------------------------------------------------
+void ofFFTAnalyzer_TimelineAdditions::setup(int _bands, int _samplerate, int _minBandwidth, int _bandsPerOctave){
+	if(fftCfg!=0 && bands==_bands && samplerate==_samplerate && minBandwidth==_minBandwidth && bandsPerOctave==_bandsPerOctave) return;
+	if(_bands < 2) return;
+	bands = _bands;
+	samplerate = _samplerate;
+	minBandwidth = _minBandwidth;
+	bandsPerOctave = _bandsPerOctave;
+
+	int signalSize = (bands-1)*2;
+	if(fftCfg!=0) kiss_fftr_free(fftCfg);
+	fftCfg = kiss_fftr_alloc(signalSize, 0, NULL, NULL);
+	cx_out.resize(bands);
+	bins.assign(bands,0);
+	binSums.assign(bands+1,0);
+	signal.assign(signalSize,0);
+
+	// same hanning window as the player
+	window.resize(signalSize);
+	float windowSum = 0;
+	for(int i = 0; i < signalSize; i++){
+		window[i] = .54 - .46 * cos((TWO_PI * i) / (signalSize - 1));
+		windowSum += window[i];
+	}
+	normalizer = 2. / windowSum;
+
+	// the bins under each average only depend on the settings
+	averageLow.clear();
+	averageHigh.clear();
+	averageScale.clear();
+	if(bandsPerOctave > 0 && minBandwidth > 0){
+		float nyquist = (float) samplerate / 2.0f;
+		int octaves = 1;
+		while ((nyquist /= 2) > minBandwidth){
+			octaves++;
+		}
+		for (int i = 0; i < octaves; i++){
+			float lowFreq = i == 0 ? 0 : (samplerate / 2) / powf(2, octaves - i);
+			float hiFreq = (samplerate / 2) / powf(2, octaves - i - 1);
+			float freqStep = (hiFreq - lowFreq) / bandsPerOctave;
+			float f = lowFreq;
+			for (int j = 0; j < bandsPerOctave; j++){
+				int low = freqToIndex(f);
+				int high = freqToIndex(f + freqStep);
+				averageLow.push_back(low);
+				averageHigh.push_back(high);
+				averageScale.push_back(1.0f / (high - low + 1));
+				f += freqStep;
+			}
+		}
+	}
+	averages.assign(averageLow.size(),0);
+}
+
+// ----------------------------------------------------------------------------
+int ofFFTAnalyzer_TimelineAdditions::freqToIndex(float freq){
+	float bandWidth = (2.0f / window.size()) * (samplerate / 2.0f);
+	if (freq < bandWidth / 2) return 0;
+	if (freq > samplerate / 2 - window.size() / 2) return bins.size() - 1;
+	float fraction = freq / samplerate;
+	return int( floor(window.size() * fraction + .5) );
+}
+
+// ----------------------------------------------------------------------------
+int ofFFTAnalyzer_TimelineAdditions::getNumBins(){
+	return bins.size();
+}
+
+// ----------------------------------------------------------------------------
+int ofFFTAnalyzer_TimelineAdditions::getSignalSize(){
+	return signal.size();
+}
+
+// ----------------------------------------------------------------------------
+int ofFFTAnalyzer_TimelineAdditions::getNumAverages(){
+	return averages.size();
+}
+
+// ----------------------------------------------------------------------------
+float * ofFFTAnalyzer_TimelineAdditions::getSignal(){
+	return signal.empty() ? NULL : &signal[0];
+}
+
+// ----------------------------------------------------------------------------
+vector<float> & ofFFTAnalyzer_TimelineAdditions::getBins(){
+	return bins;
+}
+
+// ----------------------------------------------------------------------------
+vector<float> & ofFFTAnalyzer_TimelineAdditions::getAverages(){
+	return averages;
+}
+
+// ----------------------------------------------------------------------------
+void ofFFTAnalyzer_TimelineAdditions::run(){
+	if(fftCfg==0) return;
+
+	int signalSize = signal.size();
+	int i = 0;
+#ifdef FFT_PLAN_SSE
+	for(; i+4 <= signalSize; i+=4){
+		_mm_storeu_ps(&signal[i], _mm_mul_ps(_mm_loadu_ps(&signal[i]), _mm_loadu_ps(&window[i])));
+	}
+#endif
+	for(; i < signalSize; i++){
+		signal[i] *= window[i];
+	}
+
+	kiss_fftr(fftCfg, &signal[0], &cx_out[0]);
+
+	// magnitudes and their running sum in one pass
+	double sum = 0;
+	i = 0;
+#ifdef FFT_PLAN_SSE
+	const float * spectrum = (const float *)&cx_out[0];
+	__m128 scale = _mm_set1_ps(normalizer);
+	for(; i+4 <= bands; i+=4){
+		__m128 a = _mm_loadu_ps(spectrum + i*2);
+		__m128 b = _mm_loadu_ps(spectrum + i*2 + 4);
+		__m128 re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2,0,2,0));
+		__m128 im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3,1,3,1));
+		_mm_storeu_ps(&bins[i], _mm_mul_ps(_mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(re,re), _mm_mul_ps(im,im))), scale));
+		for(int j = i; j < i+4; j++){
+			sum += bins[j];
+			binSums[j+1] = sum;
+		}
+	}
+#endif
+	for(; i < bands; i++){
+		bins[i] = sqrtf(cx_out[i].r * cx_out[i].r + cx_out[i].i * cx_out[i].i) * normalizer;
+		sum += bins[i];
+		binSums[i+1] = sum;
+	}
+
+	for(int a=0;a<(int)averages.size();a++){
+		averages[a] = (binSums[averageHigh[a]+1] - binSums[averageLow[a]]) * averageScale[a];
+	}
+}
+
+// ----------------------------------------------------------------------------
+void ofFFTAnalyzer_TimelineAdditions::setSignal(vector<short> & frames, int channels){
+	signal.assign(signal.size(),0);
+	if(channels<=0) return;
+	int numFrames = MIN(frames.size()/channels, signal.size());
+	for(int j=0;j<numFrames;j++){
+		for(int i=0;i<channels;i++){
+			signal[j] += float(frames[j*channels+i])/32565.0f;
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------
+void ofFFTAnalyzer_TimelineAdditions::analyze(vector<short> & frames, int channels, vector<float> & _averages){
+	if(fftCfg==0 || channels<=0){
+		_averages.assign(averages.size(),0);
+		return;
+	}
+	setSignal(frames, channels);
+	run();
+	_averages = averages;
+}
 
 // now, the individual sound player:
 //------------------------------------------------------------
@@ -43,9 +357,10 @@ ofOpenALSoundPlayer_TimelineAdditions::ofOpenALSoundPlayer_TimelineAdditions(){
 	isStreaming		= false;
 	channels		= 0;
 	duration		= 0;
-	fftCfg			= 0;
 	streamf			= 0;
-    octaves         = 0;
+	totalFrames		= 0;
+    currentMinBandwidth   = 0;
+    currentBandsPerOctave = 0;
     curMaxAverage   = 0;
     timeSet         = false;
 #ifdef OF_USING_MPG123
@@ -57,7 +372,6 @@ ofOpenALSoundPlayer_TimelineAdditions::ofOpenALSoundPlayer_TimelineAdditions(){
 // ----------------------------------------------------------------------------
 ofOpenALSoundPlayer_TimelineAdditions::~ofOpenALSoundPlayer_TimelineAdditions(){
 	unloadSound();
-	kiss_fftr_free(fftCfg);
 	players.erase(this);
 }
 
@@ -213,6 +527,7 @@ bool ofOpenALSoundPlayer_TimelineAdditions::sfStream(string path,vector<short> &
 		channels = sfInfo.channels;
 		duration = float(sfInfo.frames) / float(sfInfo.samplerate);
 		samplerate = sfInfo.samplerate;
+		totalFrames = sfInfo.frames;
 		stream_samples_read = 0;
 	}
 
@@ -226,7 +541,7 @@ bool ofOpenALSoundPlayer_TimelineAdditions::sfStream(string path,vector<short> &
 		if(samples_read<(int)fftAuxBuffer.size()){
 			fftAuxBuffer.resize(samples_read);
 			buffer.resize(samples_read);
-			setPosition(0);
+			sf_seek(streamf,0,SEEK_SET);
 			if(!bLoop) stopThread();
 			stream_samples_read = 0;
 			stream_end = true;
@@ -241,7 +556,7 @@ bool ofOpenALSoundPlayer_TimelineAdditions::sfStream(string path,vector<short> &
 		if(frames_read<curr_buffer_size/channels){
 			fftAuxBuffer.resize(frames_read*channels);
 			buffer.resize(frames_read*channels);
-			setPosition(0);
+			sf_seek(streamf,0,SEEK_SET);
 			if(!bLoop) stopThread();
 			stream_samples_read = 0;
 			stream_end = true;
@@ -280,6 +595,7 @@ bool ofOpenALSoundPlayer_TimelineAdditions::mpg123Stream(string path,vector<shor
 		mpg123_seek(mp3streamf,0,SEEK_END);
 		off_t samples = mpg123_tell(mp3streamf);
 		duration = float(samples/channels) / float(samplerate);
+		totalFrames = samples/channels;
 		mpg123_seek(mp3streamf,0,SEEK_SET);
 	}
 
@@ -335,6 +651,7 @@ void ofOpenALSoundPlayer_TimelineAdditions::readFile(string fileName, vector<sho
 #else
 	if(!sfReadFile(fileName,buffer,fftAuxBuffer)) return;
 #endif
+	totalFrames = buffer.size()/channels;
 	fftBuffers.resize(channels);
 	int numFrames = buffer.size()/channels;
 
@@ -372,6 +689,22 @@ bool ofOpenALSoundPlayer_TimelineAdditions::loadSound(string fileName, bool is_s
 
 	ALenum format=AL_FORMAT_MONO16;
 
+	// the stream only holds what's queued, analysis and scrubbing read through a window on the file.
+	// the window reads with libsndfile, so anything it can't open is loaded whole instead
+	if(isStreaming){
+		bool windowed = true;
+#ifdef OF_USING_MPG123
+		windowed = ext != "mp3";
+#endif
+		if(!windowed || !analysisWindow.open(fileName)){
+			ofLog(OF_LOG_ERROR,"ofOpenALSoundPlayer_TimelineAdditions: can't stream " + fileName + " with an analysis window, loading it into memory instead");
+			analysisWindow.close();
+			isStreaming = false;
+		}else{
+			streamPath = fileName;
+		}
+	}
+
 	if(!isStreaming){
 		readFile(fileName, buffer);
 	}else{
@@ -482,7 +815,8 @@ void ofOpenALSoundPlayer_TimelineAdditions::threadedFunction(){
 	vector<vector<short> > multibuffer;
 	multibuffer.resize(channels);
 	while(isThreadRunning()){
-        cout << "threaded function" << endl;
+		// setPosition seeks the same file from the main thread
+		lock();
 		for(int i=0; i<int(sources.size())/channels; i++){
 			int processed;
 			alGetSourcei(sources[i*channels], AL_BUFFERS_PROCESSED, &processed);
@@ -526,6 +860,7 @@ void ofOpenALSoundPlayer_TimelineAdditions::threadedFunction(){
 
 			stream_end = false;
 		}
+		unlock();
         timeSet = false;
 
 		ofSleepMillis(1);
@@ -555,6 +890,9 @@ void ofOpenALSoundPlayer_TimelineAdditions::update(ofEventArgs & args){
 void ofOpenALSoundPlayer_TimelineAdditions::unloadSound(){
     
 //	ofRemoveListener(ofEvents.update,this,&ofOpenALSoundPlayer_TimelineAdditions::update);
+	if(isThreadRunning()){
+		waitForThread(true);
+	}
 	if(isLoaded()){
         ofRemoveListener(ofEvents().update,this,&ofOpenALSoundPlayer_TimelineAdditions::update);
 
@@ -563,7 +901,13 @@ void ofOpenALSoundPlayer_TimelineAdditions::unloadSound(){
         
         bLoadedOk = false;
 	}
+	if(streamf){
+		sf_close(streamf);
+	}
 	streamf = 0;
+	analysisWindow.close();
+	streamPath = "";
+	totalFrames = 0;
 }
 
 //------------------------------------------------------------
@@ -609,6 +953,53 @@ int ofOpenALSoundPlayer_TimelineAdditions::getNumChannels(){
 	return channels;
 }
 
+long ofOpenALSoundPlayer_TimelineAdditions::getNumFrames(){
+	return totalFrames;
+}
+
+int ofOpenALSoundPlayer_TimelineAdditions::getSampleRate(){
+	return samplerate;
+}
+
+bool ofOpenALSoundPlayer_TimelineAdditions::getIsStreaming(){
+	return isStreaming;
+}
+
+//------------------------------------------------------------
+void ofOpenALSoundPlayer_TimelineAdditions::readFrames(long startFrame, int count, vector<short> & out){
+	readFrames(startFrame, count, out, analysisWindow);
+}
+
+//------------------------------------------------------------
+void ofOpenALSoundPlayer_TimelineAdditions::readFrames(long startFrame, int count, vector<short> & out, ofSoundFileWindow_TimelineAdditions & window){
+	if(count <= 0 || channels == 0){
+		out.clear();
+		return;
+	}
+	out.resize(count*channels);
+	if(isStreaming){
+		// a window that didn't open shares the player's
+		(window.isOpen() ? window : analysisWindow).readFrames(startFrame, count, &out[0]);
+		return;
+	}
+	for(int j=0;j<count;j++){
+		long frame = startFrame+j;
+		bool inside = frame >= 0 && frame < totalFrames;
+		for(int i=0;i<channels;i++){
+			out[j*channels+i] = inside ? buffer[frame*channels+i] : 0;
+		}
+	}
+}
+
+//------------------------------------------------------------
+bool ofOpenALSoundPlayer_TimelineAdditions::openWindow(ofSoundFileWindow_TimelineAdditions & window){
+	window.close();
+	if(!isStreaming){
+		return false;
+	}
+	return window.open(streamPath);
+}
+
 //------------------------------------------------------------
 vector<short> & ofOpenALSoundPlayer_TimelineAdditions::getBuffer(){
 	return buffer;
@@ -644,8 +1035,13 @@ void ofOpenALSoundPlayer_TimelineAdditions::setPosition(float pct){
 	}else
 #endif
 	if(streamf){
-		sf_seek(streamf,duration*pct*samplerate*channels,SEEK_SET);
-		stream_samples_read = 0;
+		// sf_seek counts frames, the next buffers queued come from the new position
+		sf_count_t frame = ofClamp(pct,0,1)*totalFrames;
+		lock();
+		sf_seek(streamf,frame,SEEK_SET);
+		stream_samples_read = frame*channels;
+		stream_end = false;
+		unlock();
 	}else{
 		for(int i=0;i<(int)channels;i++){
 			alSourcef(sources[sources.size()-channels+i],AL_SEC_OFFSET,pct*duration);
@@ -730,9 +1126,17 @@ void ofOpenALSoundPlayer_TimelineAdditions::setPan(float p){
 void ofOpenALSoundPlayer_TimelineAdditions::setPaused(bool bP){
 	if(sources.empty()) return;
 	if(bP){
+		// the stream thread restarts stalled sources, so it has to stop first
+		if(isStreaming && isThreadRunning()){
+			waitForThread(true);
+		}
 		alSourcePausev(sources.size(),&sources[0]);
 	}else{
 		alSourcePlayv(sources.size(),&sources[0]);
+		if(isStreaming && !isThreadRunning()){
+			stream_end = false;
+			startThread(true,false);
+		}
 	}
 
 	bPaused = bP;
@@ -819,20 +1223,12 @@ void ofOpenALSoundPlayer_TimelineAdditions::play(){
 
 // ----------------------------------------------------------------------------
 void ofOpenALSoundPlayer_TimelineAdditions::stop(){
+	if(isStreaming && isThreadRunning()){
+		waitForThread(true);
+	}
 	alSourceStopv(channels,&sources[sources.size()-channels]);
 }
 
-// ----------------------------------------------------------------------------
-void ofOpenALSoundPlayer_TimelineAdditions::initFFT(int bands){
-	if(int(bins.size())==bands) return;
-	int signalSize = (bands-1)*2;
-	if(fftCfg!=0) kiss_fftr_free(fftCfg);
-	fftCfg = kiss_fftr_alloc(signalSize, 0, NULL, NULL);
-	cx_out.resize(bands);
-	bins.resize(bands);
-	createWindow(signalSize);
-}
-
 // ----------------------------------------------------------------------------
 void ofOpenALSoundPlayer_TimelineAdditions::initSystemFFT(int bands){
 	if(int(systemBins.size())==bands) return;
@@ -848,7 +1244,27 @@ float * ofOpenALSoundPlayer_TimelineAdditions::getCurrentBufferSum(int size){
 	if(int(windowedSignal.size())!=size){
 		windowedSignal.resize(size);
 	}
-	windowedSignal.assign(windowedSignal.size(),0);
+	getCurrentBufferSum(&windowedSignal[0], size);
+	return &windowedSignal[0];
+}
+
+void ofOpenALSoundPlayer_TimelineAdditions::getCurrentBufferSum(float * signal, int size){
+	for(int j=0;j<size;j++){
+		signal[j]=0;
+	}
+	if(sources.empty() || channels==0) return;
+	if(isStreaming){
+		// fftBuffers only holds the last decoded stream buffer, read around the play head instead
+		readFrames(getPosition()*totalFrames, size, analysisFrames);
+		for(int i=0;i<channels && !analysisFrames.empty();i++){
+			float gain;
+			alGetSourcef(sources[i],AL_GAIN,&gain);
+			for(int j=0;j<size;j++){
+				signal[j]+=float(analysisFrames[j*channels+i])/32565.0f*gain;
+			}
+		}
+		return;
+	}
 	for(int k=0;k<int(sources.size())/channels;k++){
 		if(!isStreaming){
 			ALint state;
@@ -863,13 +1279,12 @@ float * ofOpenALSoundPlayer_TimelineAdditions::getCurrentBufferSum(int size){
 			alGetSourcef(sources[k*channels+i],AL_GAIN,&gain);
 			for(int j=0;j<size;j++){
 				if(pos+j<(int)fftBuffers[i].size())
-					windowedSignal[j]+=fftBuffers[i][pos+j]*gain;
+					signal[j]+=fftBuffers[i][pos+j]*gain;
 				else
-					windowedSignal[j]=0;
+					signal[j]=0;
 			}
 		}
 	}
-	return &windowedSignal[0];
 }
 
 vector<float>& ofOpenALSoundPlayer_TimelineAdditions::getCurrentBuffer(int _size)
@@ -883,19 +1298,20 @@ vector<float>& ofOpenALSoundPlayer_TimelineAdditions::getCurrentBuffer(int _size
     int pos;
 	for(int k = 0; k < int(sources.size())/channels; ++k)
     {
-		alGetSourcei(sources[k*channels],AL_SAMPLE_OFFSET,&pos);
+        if(isStreaming)
+        {
+            pos = getPosition()*totalFrames;
+        }
+        else
+        {
+            alGetSourcei(sources[k*channels],AL_SAMPLE_OFFSET,&pos);
+        }
+        readFrames(pos, _size, analysisFrames);
         for(int i = 0; i < channels; ++i)
         {
             for(int j = 0; j < _size; ++j)
             {
-                if(pos+j<(int)buffer.size())
-                {
-                    currentBuffer[j] += float(buffer[(pos+j)*channels+i])/65534.0f;
-                }
-                else
-                {
-                    currentBuffer[j] = 0;
-                }
+                currentBuffer[j] += float(analysisFrames[j*channels+i])/65534.0f;
             }
         }
     }
@@ -910,21 +1326,15 @@ vector<float>& ofOpenALSoundPlayer_TimelineAdditions::getBufferForFrame(int _fra
 	}
    	currentBuffer.assign(currentBuffer.size(),0);
     
-    int pos = _frame*float(samplerate)/_fps;
+    long pos = _frame*float(samplerate)/_fps;
+    readFrames(pos, _size, analysisFrames);
 	for(int k = 0; k < int(sources.size())/channels; ++k)
     {
         for(int i = 0; i < channels; ++i)
         {
             for(int j = 0; j < _size; ++j)
             {
-                if(pos+j<(int)buffer.size())
-                {
-                    currentBuffer[j] += float(buffer[(pos+j)*channels+i])/65534.0f;
-                }
-                else
-                {
-                    currentBuffer[j] = 0;
-                }
+                currentBuffer[j] += float(analysisFrames[j*channels+i])/65534.0f;
             }
         }
     }
@@ -933,70 +1343,20 @@ vector<float>& ofOpenALSoundPlayer_TimelineAdditions::getBufferForFrame(int _fra
 
 // ----------------------------------------------------------------------------
 vector<float>& ofOpenALSoundPlayer_TimelineAdditions::getSpectrum(int bands){
-
-	initFFT(bands);
-	bins.assign(bins.size(),0);
-	if(sources.empty()) return bins;
-
-	int signalSize = (bands-1)*2;
-	getCurrentBufferSum(signalSize);
-
-	float normalizer = 2. / windowSum;
-	runWindow(windowedSignal);
-	kiss_fftr(fftCfg, &windowedSignal[0], &cx_out[0]);
-	for(int i= 0; i < bands; i++) {
-		bins[i] += sqrtf(cx_out[i].r * cx_out[i].r + cx_out[i].i * cx_out[i].i) * normalizer;
-	}
-	return bins;
+	// the plan only rebuilds when the settings change
+	spectrumPlan.setup(bands, samplerate, currentMinBandwidth, currentBandsPerOctave);
+	if(spectrumPlan.getSignalSize() == 0) return spectrumPlan.getBins();
+	getCurrentBufferSum(spectrumPlan.getSignal(), spectrumPlan.getSignalSize());
+	spectrumPlan.run();
+	return spectrumPlan.getBins();
 }
 
 // ----------------------------------------------------------------------------
 vector<float>& ofOpenALSoundPlayer_TimelineAdditions::getAverages(){
-    
-    if(averages.size() > 0){
-        getSpectrum(bins.size());
-        float max = 0;
-        for (int i = 0; i < octaves; i++){
-            float lowFreq, hiFreq, freqStep;
-            if (i == 0){
-                lowFreq = 0;
-            }
-            else{
-                lowFreq = (samplerate / 2) / powf(2, octaves - i);
-            }
-            
-            hiFreq = (samplerate / 2) / powf(2, octaves - i - 1);
-            freqStep = (hiFreq - lowFreq) / avgPerOctave;
-            float f = lowFreq;
-            for (int j = 0; j < avgPerOctave; j++){
-                int offset = j + i * avgPerOctave;
-                averages[offset] = calculateAverage(f, f + freqStep);
-                max = MAX(max,averages[offset]);
-                f += freqStep;
-            }
-        }
+    if(currentBandsPerOctave > 0 && spectrumPlan.getNumBins() > 0){
+        getSpectrum(spectrumPlan.getNumBins());
     }
-    
-    
-    return averages;
-}
-
-float ofOpenALSoundPlayer_TimelineAdditions::calculateAverage(float lowFreq, float hiFreq) {
-    int lowBound = freqToIndex(lowFreq);
-    int hiBound = freqToIndex(hiFreq);
-    float avg = 0;
-    for (int i = lowBound; i <= hiBound; i++) {
-        avg += bins[i];
-    }
-    avg /= (hiBound - lowBound + 1);
-    return avg;
-}
-
-int ofOpenALSoundPlayer_TimelineAdditions::freqToIndex(float freq) {
-    if (freq < bandWidth / 2) return 0;
-    if (freq > samplerate / 2 - window.size() / 2) return bins.size() - 1;
-    float fraction = freq / samplerate;
-    return int( floor(window.size() * fraction + .5) );
+    return spectrumPlan.getAverages();
 }
 
 //http://code.compartmental.net/2007/03/21/fft-averages/
@@ -1006,17 +1366,9 @@ void ofOpenALSoundPlayer_TimelineAdditions::setLogAverages(int minBandwidth, int
         return;
     }
     
+    // the spectrum plan picks these up the next time it runs
     currentMinBandwidth = minBandwidth;
     currentBandsPerOctave = bandsPerOctave;
-
-    float nyquist = (float) samplerate / 2.0f;
-    octaves = 1;
-    while ((nyquist /= 2) > minBandwidth){
-        octaves++;
-    }
-    
-    avgPerOctave = bandsPerOctave;
-    averages.resize(octaves * bandsPerOctave);
 }
 
 // ----------------------------------------------------------------------------
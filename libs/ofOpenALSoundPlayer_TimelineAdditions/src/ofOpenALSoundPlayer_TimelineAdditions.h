@@ -65,6 +65,96 @@
 //virtual bool isLoaded() = 0;
 //virtual float getVolume() = 0;
 
+// --------------------- streamed file window:
+// random access to the frames of a sound file on disk through a few cached chunks,
+// so a streamed sound can be analyzed and scrubbed without decoding all of it
+class ofSoundFileWindow_TimelineAdditions {
+
+	public:
+
+		ofSoundFileWindow_TimelineAdditions();
+		~ofSoundFileWindow_TimelineAdditions();
+
+		bool open(string path);
+		void close();
+		bool isOpen();
+
+		int getNumChannels();
+		long getNumFrames();
+		int getSampleRate();
+
+		// copies count interleaved frames from startFrame into out, frames outside the file are silent
+		void readFrames(long startFrame, int count, short * out);
+
+	protected:
+
+		struct Chunk {
+			long index;
+			unsigned long lastUsed;
+			vector<short> samples;
+		};
+		Chunk & getChunk(long index);
+
+		SNDFILE* file;
+		int channels;
+		long frames;
+		int samplerate;
+		unsigned long useCount;
+		vector<Chunk> chunks;
+		ofMutex mutex;
+};
+
+// --------------------- fft plan:
+// everything the log averaged spectrum needs for one set of settings, worked out once so
+// running it doesn't allocate or recompute band edges. the player uses one for its live
+// spectrum, and because it has its own fft state others can run on any frames on another thread
+class ofFFTAnalyzer_TimelineAdditions {
+
+	public:
+
+		ofFFTAnalyzer_TimelineAdditions();
+		~ofFFTAnalyzer_TimelineAdditions();
+
+		// does nothing if the settings haven't changed, bandsPerOctave of 0 skips the averages
+		void setup(int bands, int samplerate, int minBandwidth, int bandsPerOctave);
+		int getNumBins();
+		int getSignalSize();
+		int getNumAverages();
+
+		// fill getSignalSize() samples of the unwindowed signal, then run
+		float * getSignal();
+		// or sum interleaved frames into it
+		void setSignal(vector<short> & frames, int channels);
+		void run();
+		vector<float> & getBins();
+		vector<float> & getAverages();
+
+		// frames are interleaved and the channels are summed before the fft
+		void analyze(vector<short> & frames, int channels, vector<float> & averages);
+
+	protected:
+
+		int freqToIndex(float freq);
+
+		kiss_fftr_cfg fftCfg;
+		int bands;
+		int samplerate;
+		int minBandwidth;
+		int bandsPerOctave;
+		vector<float> window;
+		float normalizer;
+		vector<float> signal;
+		vector<kiss_fft_cpx> cx_out;
+		vector<float> bins;
+		// running sum of the bins so each average is one subtraction
+		vector<double> binSums;
+		// the bins each average spans, inclusive, and one over their count
+		vector<int> averageLow;
+		vector<int> averageHigh;
+		vector<float> averageScale;
+		vector<float> averages;
+};
+
 // --------------------- player functions:
 class ofOpenALSoundPlayer_TimelineAdditions : public ofBaseSoundPlayer, public ofThread {
 
@@ -97,6 +187,17 @@ class ofOpenALSoundPlayer_TimelineAdditions : public ofBaseSoundPlayer, public o
 		bool getIsPaused();
 		float getDuration();
 		int getNumChannels();
+		long getNumFrames();
+		int getSampleRate();
+		bool getIsStreaming();
+
+		// interleaved frames from anywhere in the sound, read from disk when streaming
+		void readFrames(long startFrame, int count, vector<short> & out);
+		// the same through a window of the caller's, so a reader on another thread
+		// doesn't evict the chunks the play head is reading. open it with openWindow()
+		void readFrames(long startFrame, int count, vector<short> & out, ofSoundFileWindow_TimelineAdditions & window);
+		// opens window on the streamed file, false when the sound isn't streamed
+		bool openWindow(ofSoundFileWindow_TimelineAdditions & window);
     
 		static void initialize();
 		static void close();
@@ -121,8 +222,8 @@ class ofOpenALSoundPlayer_TimelineAdditions : public ofBaseSoundPlayer, public o
 
 		void ofOpenALSoundUpdate();
 		void update(ofEventArgs & args);
-		void initFFT(int bands);
 		float *getCurrentBufferSum(int size);
+		void getCurrentBufferSum(float * signal, int size);
     
 		void createWindow(int size);
 		void runWindow(vector<float> & signal);
@@ -164,20 +265,11 @@ class ofOpenALSoundPlayer_TimelineAdditions : public ofBaseSoundPlayer, public o
 
 		// fft structures
 		vector<vector<float> > fftBuffers;
-		kiss_fftr_cfg fftCfg;
 		vector<float> windowedSignal;
-		vector<float> bins;
-    	vector<float> averages;
+		ofFFTAnalyzer_TimelineAdditions spectrumPlan;
         int currentMinBandwidth;
         int currentBandsPerOctave;
 
-        int avgPerOctave;
-        int octaves;
-		vector<kiss_fft_cpx> cx_out;
-
-        float calculateAverage(float lowFreq, float hiFreq);
-        int freqToIndex(float freq);
-
 		static kiss_fftr_cfg systemFftCfg;
 		static vector<float> systemWindowedSignal;
 		static vector<float> systemBins;
@@ -194,6 +286,10 @@ class ofOpenALSoundPlayer_TimelineAdditions : public ofBaseSoundPlayer, public o
 		double stream_scale;
 		vector<short> buffer;
 		vector<float> fftAuxBuffer;
+		long totalFrames;
+		ofSoundFileWindow_TimelineAdditions analysisWindow;
+		string streamPath;
+		vector<short> analysisFrames;
         float curMaxAverage;
     
 		bool stream_end;
@@ -33,6 +33,625 @@
 #include "ofxTLAudioTrack.h"
 #include "ofxTimeline.h"
 
+#define OFXTL_WAVEFORM_LEVELS 3
+#define OFXTL_WAVEFORM_BASE_FRAMES 256
+#define OFXTL_WAVEFORM_LEVEL_SCALE 16
+#define OFXTL_WAVEFORM_STREAM_FRAMES 65536
+#define OFXTL_FFT_CACHE_DECIBELS 96.0
+#define OFXTL_FFT_CACHE_VERSION 2
+#define OFXTL_SPECTROGRAM_BINS 513
+#define OFXTL_SPECTROGRAM_ROWS 128
+#define OFXTL_SPECTROGRAM_LEVELS 3
+#define OFXTL_SPECTROGRAM_LEVEL_SCALE 16
+#define OFXTL_SPECTROGRAM_TILE_COLUMNS 256
+#define OFXTL_SPECTROGRAM_TEXTURES 64
+#define OFXTL_SPECTROGRAM_DECIBELS 80.0
+
+ofxTLWaveformPyramid::ofxTLWaveformPyramid()
+:	numChannels(0),
+	numFrames(0),
+	framesAdded(0)
+{
+}
+
+void ofxTLWaveformPyramid::clear(){
+	levels.clear();
+	numChannels = 0;
+	numFrames = 0;
+	framesAdded = 0;
+}
+
+void ofxTLWaveformPyramid::build(vector<short>& buffer, int channels){
+	if(channels <= 0){
+		clear();
+		return;
+	}
+	begin(channels, buffer.size() / channels);
+	if(numFrames > 0){
+		addFrames(&buffer[0], numFrames);
+	}
+	finish();
+}
+
+void ofxTLWaveformPyramid::begin(int channels, long frames){
+	clear();
+	if(channels <= 0){
+		return;
+	}
+	numChannels = channels;
+	numFrames = frames;
+	levels.resize(OFXTL_WAVEFORM_LEVELS);
+	int numBuckets = (numFrames + OFXTL_WAVEFORM_BASE_FRAMES - 1) / OFXTL_WAVEFORM_BASE_FRAMES;
+	levels[0].resize(numBuckets * numChannels);
+}
+
+void ofxTLWaveformPyramid::addFrames(const short* frames, int count){
+	if(levels.empty()){
+		return;
+	}
+	
+	//level 0 from the samples, a bucket can straddle two calls
+	count = MIN(long(count), numFrames - framesAdded);
+	for(int i = 0; i < count; i++){
+		long frame = framesAdded + i;
+		Bucket* bucket = &levels[0][(frame / OFXTL_WAVEFORM_BASE_FRAMES) * numChannels];
+		bool first = (frame % OFXTL_WAVEFORM_BASE_FRAMES) == 0;
+		for(int c = 0; c < numChannels; c++){
+			short sample = frames[i*numChannels + c];
+			if(first){
+				bucket[c].min = bucket[c].max = sample;
+			}
+			else{
+				if(sample < bucket[c].min) bucket[c].min = sample;
+				if(sample > bucket[c].max) bucket[c].max = sample;
+			}
+		}
+	}
+	framesAdded += count;
+}
+
+void ofxTLWaveformPyramid::finish(){
+	//every other level merges runs of buckets from the one below
+	for(int l = 1; l < levels.size(); l++){
+		vector<Bucket>& below = levels[l-1];
+		int belowBuckets = below.size() / numChannels;
+		int numBuckets = (belowBuckets + OFXTL_WAVEFORM_LEVEL_SCALE - 1) / OFXTL_WAVEFORM_LEVEL_SCALE;
+		levels[l].resize(numBuckets * numChannels);
+		for(int b = 0; b < numBuckets; b++){
+			int startBucket = b * OFXTL_WAVEFORM_LEVEL_SCALE;
+			int endBucket = MIN(startBucket + OFXTL_WAVEFORM_LEVEL_SCALE, belowBuckets);
+			for(int c = 0; c < numChannels; c++){
+				Bucket& bucket = levels[l][b*numChannels + c];
+				bucket = below[startBucket*numChannels + c];
+				for(int s = startBucket+1; s < endBucket; s++){
+					Bucket& source = below[s*numChannels + c];
+					if(source.min < bucket.min) bucket.min = source.min;
+					if(source.max > bucket.max) bucket.max = source.max;
+				}
+			}
+		}
+	}
+}
+
+int ofxTLWaveformPyramid::getNumLevels(){
+	return levels.size();
+}
+
+int ofxTLWaveformPyramid::getFramesPerBucket(int level){
+	int frames = OFXTL_WAVEFORM_BASE_FRAMES;
+	for(int l = 0; l < level; l++){
+		frames *= OFXTL_WAVEFORM_LEVEL_SCALE;
+	}
+	return frames;
+}
+
+int ofxTLWaveformPyramid::getLevelForFramesPerPixel(double framesPerPixel){
+	int level = -1;
+	while(level+1 < getNumLevels() && getFramesPerBucket(level+1) <= framesPerPixel){
+		level++;
+	}
+	return level;
+}
+
+void ofxTLWaveformPyramid::getRange(vector<short>& buffer, long bufferStartFrame, int level, int channel, long startFrame, long endFrame, short& low, short& high){
+	startFrame = MAX(startFrame, 0L);
+	endFrame = MIN(endFrame, numFrames);
+	if(level < 0){
+		startFrame = MAX(startFrame, bufferStartFrame);
+		endFrame = MIN(endFrame, bufferStartFrame + long(buffer.size() / numChannels));
+	}
+	low = high = 0;
+	if(startFrame >= endFrame){
+		return;
+	}
+	
+	if(level < 0){
+		low = high = buffer[(startFrame-bufferStartFrame)*numChannels + channel];
+		for(long f = startFrame+1; f < endFrame; f++){
+			short sample = buffer[(f-bufferStartFrame)*numChannels + channel];
+			if(sample < low) low = sample;
+			if(sample > high) high = sample;
+		}
+		return;
+	}
+	
+	//the buckets overlapping the range, they're at most a pixel wide so the edges don't show
+	long framesPerBucket = getFramesPerBucket(level);
+	long startBucket = startFrame / framesPerBucket;
+	long endBucket = (endFrame + framesPerBucket - 1) / framesPerBucket;
+	vector<Bucket>& buckets = levels[level];
+	low = buckets[startBucket*numChannels + channel].min;
+	high = buckets[startBucket*numChannels + channel].max;
+	for(long b = startBucket+1; b < endBucket; b++){
+		Bucket& bucket = buckets[b*numChannels + channel];
+		if(bucket.min < low) low = bucket.min;
+		if(bucket.max > high) high = bucket.max;
+	}
+}
+
+ofxTLFFTCache::ofxTLFFTCache(){
+	player = NULL;
+	fileHash = 0;
+	clear();
+	//quantized bands are decibels below the frame's loudest band, 0 is silence
+	decibelTable[0] = 0;
+	for(int i = 1; i < 256; i++){
+		decibelTable[i] = powf(10, (i - 255) * OFXTL_FFT_CACHE_DECIBELS / 255.0 / 20.0);
+	}
+}
+
+ofxTLFFTCache::~ofxTLFFTCache(){
+	clear();
+}
+
+void ofxTLFFTCache::setup(ofOpenALSoundPlayer_TimelineAdditions* _player, string _soundPath, string _cacheFolder,
+						  float _fps, int _bands, int _minBandwidth, int _bandsPerOctave){
+	clear();
+	if(_player == NULL || !_player->isLoaded() || _fps <= 0){
+		return;
+	}
+	
+	player = _player;
+	soundPath = _soundPath;
+	cacheFolder = ofFilePath::addTrailingSlash(_cacheFolder);
+	fps = _fps;
+	bands = _bands;
+	minBandwidth = _minBandwidth;
+	bandsPerOctave = _bandsPerOctave;
+	
+	ofFFTAnalyzer_TimelineAdditions sizing;
+	sizing.setup(bands, player->getSampleRate(), minBandwidth, bandsPerOctave);
+	numAverages = sizing.getNumAverages();
+	numFrames = ceil(player->getDuration() * fps);
+	frameMax.assign(numFrames, 0);
+	frameBands.assign(numFrames * numAverages, 0);
+	
+	//read a streamed sound through a window of our own, sharing the player's
+	//would have the play head and the other readers evicting each other's chunks
+	player->openWindow(window);
+	startThread(true, false);
+}
+
+void ofxTLFFTCache::clear(){
+	if(isThreadRunning()){
+		waitForThread(true);
+	}
+	window.close();
+	player = NULL;
+	cachePath = "";
+	fps = 0;
+	bands = 0;
+	minBandwidth = 0;
+	bandsPerOctave = 0;
+	numFrames = 0;
+	numAverages = 0;
+	framesAnalyzed = 0;
+	ready = false;
+	frameMax.clear();
+	frameBands.clear();
+}
+
+bool ofxTLFFTCache::isSetup(float _fps, int _bands, int _minBandwidth, int _bandsPerOctave){
+	return player != NULL && fps == _fps && bands == _bands && minBandwidth == _minBandwidth && bandsPerOctave == _bandsPerOctave;
+}
+
+bool ofxTLFFTCache::isReady(){
+	lock();
+	bool isReady = ready;
+	unlock();
+	return isReady;
+}
+
+float ofxTLFFTCache::getProgress(){
+	if(numFrames == 0){
+		return 0;
+	}
+	lock();
+	float progress = float(framesAnalyzed) / numFrames;
+	unlock();
+	return progress;
+}
+
+int ofxTLFFTCache::getNumFrames(){
+	return numFrames;
+}
+
+string ofxTLFFTCache::getCachePath(){
+	lock();
+	string path = cachePath;
+	unlock();
+	return path;
+}
+
+bool ofxTLFFTCache::getFrame(int frame, vector<float>& averages){
+	lock();
+	bool analyzed = frame >= 0 && frame < framesAnalyzed;
+	if(analyzed){
+		averages.resize(numAverages);
+		decode(frameMax[frame], &frameBands[frame*numAverages], averages);
+	}
+	unlock();
+	return analyzed;
+}
+
+void ofxTLFFTCache::quantize(vector<float>& averages){
+	if(averages.empty()){
+		return;
+	}
+	float max;
+	vector<unsigned char> quantized(averages.size());
+	encode(averages, max, &quantized[0]);
+	decode(max, &quantized[0], averages);
+}
+
+void ofxTLFFTCache::encode(vector<float>& averages, float& max, unsigned char* quantized){
+	max = 0;
+	for(int i = 0; i < averages.size(); i++){
+		max = MAX(max, averages[i]);
+	}
+	for(int i = 0; i < averages.size(); i++){
+		if(max <= 0 || averages[i] <= 0){
+			quantized[i] = 0;
+			continue;
+		}
+		float decibels = 20 * log10f(averages[i] / max);
+		if(decibels < -OFXTL_FFT_CACHE_DECIBELS){
+			quantized[i] = 0;
+		}
+		else{
+			quantized[i] = ofClamp(255 + decibels * 255 / OFXTL_FFT_CACHE_DECIBELS + .5, 1, 255);
+		}
+	}
+}
+
+void ofxTLFFTCache::decode(float max, unsigned char* quantized, vector<float>& averages){
+	for(int i = 0; i < averages.size(); i++){
+		averages[i] = decibelTable[quantized[i]] * max;
+	}
+}
+
+void ofxTLFFTCache::threadedFunction(){
+	
+	//hash the whole file so an edited sound never picks up a stale cache
+	FILE* file = fopen(soundPath.c_str(), "rb");
+	if(file == NULL){
+		ofLogError("ofxTLFFTCache -- couldn't read " + soundPath + " to analyze");
+		return;
+	}
+	unsigned long long hash = 14695981039346656037ULL;
+	vector<unsigned char> chunk(1 << 20);
+	size_t bytesRead;
+	while(isThreadRunning() && (bytesRead = fread(&chunk[0], 1, chunk.size(), file)) > 0){
+		for(size_t i = 0; i < bytesRead; i++){
+			hash = (hash ^ chunk[i]) * 1099511628211ULL;
+		}
+	}
+	fclose(file);
+	if(!isThreadRunning()){
+		return;
+	}
+	
+	char hashString[17];
+	sprintf(hashString, "%016llx", hash);
+	lock();
+	fileHash = hash;
+	cachePath = cacheFolder + hashString + "_" + ofToString(bands) + "_" + ofToString(minBandwidth) + "_" +
+				ofToString(bandsPerOctave) + "_" + ofToString(fps) + ".fft";
+	unlock();
+	
+	if(load()){
+		lock();
+		framesAnalyzed = numFrames;
+		ready = true;
+		unlock();
+		return;
+	}
+	
+	ofFFTAnalyzer_TimelineAdditions analyzer;
+	analyzer.setup(bands, player->getSampleRate(), minBandwidth, bandsPerOctave);
+	vector<short> frames;
+	vector<float> averages;
+	vector<unsigned char> quantized(numAverages);
+	for(int f = 0; f < numFrames && isThreadRunning(); f++){
+		player->readFrames(long(f * double(player->getSampleRate()) / fps), analyzer.getSignalSize(), frames, window);
+		analyzer.analyze(frames, player->getNumChannels(), averages);
+		float max;
+		encode(averages, max, &quantized[0]);
+		
+		lock();
+		frameMax[f] = max;
+		memcpy(&frameBands[f*numAverages], &quantized[0], numAverages);
+		framesAnalyzed = f+1;
+		unlock();
+	}
+	
+	if(framesAnalyzed == numFrames){
+		save();
+		lock();
+		ready = true;
+		unlock();
+	}
+}
+
+bool ofxTLFFTCache::load(){
+	FILE* file = fopen(cachePath.c_str(), "rb");
+	if(file == NULL){
+		return false;
+	}
+	
+	//the name already has the key, the header makes sure the file is whole
+	int version, fileBands, fileMinBandwidth, fileBandsPerOctave, fileFrames, fileAverages;
+	unsigned long long hash;
+	float fileFps;
+	bool matches =
+		fread(&version, sizeof(int), 1, file) == 1 && version == OFXTL_FFT_CACHE_VERSION &&
+		fread(&hash, sizeof(hash), 1, file) == 1 && hash == fileHash &&
+		fread(&fileBands, sizeof(int), 1, file) == 1 && fileBands == bands &&
+		fread(&fileMinBandwidth, sizeof(int), 1, file) == 1 && fileMinBandwidth == minBandwidth &&
+		fread(&fileBandsPerOctave, sizeof(int), 1, file) == 1 && fileBandsPerOctave == bandsPerOctave &&
+		fread(&fileFps, sizeof(float), 1, file) == 1 && fileFps == fps &&
+		fread(&fileFrames, sizeof(int), 1, file) == 1 && fileFrames == numFrames &&
+		fread(&fileAverages, sizeof(int), 1, file) == 1 && fileAverages == numAverages &&
+		fread(&frameMax[0], sizeof(float), numFrames, file) == numFrames &&
+		fread(&frameBands[0], 1, frameBands.size(), file) == frameBands.size();
+	fclose(file);
+	
+	if(!matches){
+		ofLogWarning("ofxTLFFTCache -- ignoring out of date cache " + cachePath);
+	}
+	return matches;
+}
+
+void ofxTLFFTCache::save(){
+	if(numFrames == 0){
+		return;
+	}
+	ofDirectory::createDirectory(cacheFolder, false, true);
+	FILE* file = fopen(cachePath.c_str(), "wb");
+	if(file == NULL){
+		ofLogError("ofxTLFFTCache -- couldn't write cache " + cachePath);
+		return;
+	}
+	int version = OFXTL_FFT_CACHE_VERSION;
+	fwrite(&version, sizeof(int), 1, file);
+	fwrite(&fileHash, sizeof(fileHash), 1, file);
+	fwrite(&bands, sizeof(int), 1, file);
+	fwrite(&minBandwidth, sizeof(int), 1, file);
+	fwrite(&bandsPerOctave, sizeof(int), 1, file);
+	fwrite(&fps, sizeof(float), 1, file);
+	fwrite(&numFrames, sizeof(int), 1, file);
+	fwrite(&numAverages, sizeof(int), 1, file);
+	fwrite(&frameMax[0], sizeof(float), numFrames, file);
+	fwrite(&frameBands[0], 1, frameBands.size(), file);
+	fclose(file);
+}
+
+ofxTLSpectrogram::ofxTLSpectrogram(){
+	player = NULL;
+	numColumns = 0;
+	columnsAnalyzed = 0;
+	tileUseCount = 0;
+	
+	//rows from the first bin up to nyquist, the lowest ones repeat a bin
+	int lastBin = OFXTL_SPECTROGRAM_BINS - 1;
+	for(int r = 0; r < OFXTL_SPECTROGRAM_ROWS; r++){
+		int low = powf(lastBin, float(r) / OFXTL_SPECTROGRAM_ROWS) + .5;
+		int high = powf(lastBin, float(r+1) / OFXTL_SPECTROGRAM_ROWS) + .5;
+		rowLow.push_back(low);
+		rowHigh.push_back(ofClamp(high - 1, low, lastBin));
+	}
+	
+	Tile tile;
+	tile.level = -1;
+	tile.index = -1;
+	tile.columnsLoaded = 0;
+	tile.lastUsed = 0;
+	tile.texture = NULL;
+	tiles.resize(OFXTL_SPECTROGRAM_TEXTURES, tile);
+	tilePixels.resize(OFXTL_SPECTROGRAM_TILE_COLUMNS * OFXTL_SPECTROGRAM_ROWS);
+}
+
+ofxTLSpectrogram::~ofxTLSpectrogram(){
+	clear();
+}
+
+void ofxTLSpectrogram::setup(ofOpenALSoundPlayer_TimelineAdditions* _player){
+	clear();
+	if(_player == NULL || !_player->isLoaded() || _player->getNumFrames() == 0){
+		return;
+	}
+	
+	player = _player;
+	numColumns = (player->getNumFrames() + getFramesPerColumn(0) - 1) / getFramesPerColumn(0);
+	levels.resize(OFXTL_SPECTROGRAM_LEVELS);
+	int levelColumns = numColumns;
+	for(int l = 0; l < levels.size(); l++){
+		levels[l].assign(levelColumns * OFXTL_SPECTROGRAM_ROWS, 0);
+		levelColumns = (levelColumns + OFXTL_SPECTROGRAM_LEVEL_SCALE - 1) / OFXTL_SPECTROGRAM_LEVEL_SCALE;
+	}
+	player->openWindow(window);
+	startThread(true, false);
+}
+
+void ofxTLSpectrogram::clear(){
+	if(isThreadRunning()){
+		waitForThread(true);
+	}
+	window.close();
+	player = NULL;
+	numColumns = 0;
+	columnsAnalyzed = 0;
+	levels.clear();
+	for(int i = 0; i < tiles.size(); i++){
+		if(tiles[i].texture != NULL){
+			delete tiles[i].texture;
+			tiles[i].texture = NULL;
+		}
+		tiles[i].level = -1;
+		tiles[i].index = -1;
+		tiles[i].columnsLoaded = 0;
+		tiles[i].lastUsed = 0;
+	}
+}
+
+bool ofxTLSpectrogram::isSetup(){
+	return player != NULL;
+}
+
+float ofxTLSpectrogram::getProgress(){
+	if(numColumns == 0){
+		return 0;
+	}
+	lock();
+	float progress = float(columnsAnalyzed) / numColumns;
+	unlock();
+	return progress;
+}
+
+int ofxTLSpectrogram::getFramesPerColumn(int level){
+	//one fft per column with no overlap
+	int frames = (OFXTL_SPECTROGRAM_BINS - 1) * 2;
+	for(int l = 0; l < level; l++){
+		frames *= OFXTL_SPECTROGRAM_LEVEL_SCALE;
+	}
+	return frames;
+}
+
+int ofxTLSpectrogram::getColumnsReady(int level){
+	int scale = getFramesPerColumn(level) / getFramesPerColumn(0);
+	if(columnsAnalyzed == numColumns){
+		return (numColumns + scale - 1) / scale;
+	}
+	return columnsAnalyzed / scale;
+}
+
+void ofxTLSpectrogram::threadedFunction(){
+	ofFFTAnalyzer_TimelineAdditions plan;
+	plan.setup(OFXTL_SPECTROGRAM_BINS, player->getSampleRate(), 0, 0);
+	vector<short> frames;
+	unsigned char column[OFXTL_SPECTROGRAM_ROWS];
+	for(int c = 0; c < numColumns && isThreadRunning(); c++){
+		player->readFrames(long(c) * plan.getSignalSize(), plan.getSignalSize(), frames, window);
+		plan.setSignal(frames, player->getNumChannels());
+		plan.run();
+		vector<float>& bins = plan.getBins();
+		for(int r = 0; r < OFXTL_SPECTROGRAM_ROWS; r++){
+			float magnitude = 0;
+			for(int b = rowLow[r]; b <= rowHigh[r]; b++){
+				magnitude = MAX(magnitude, bins[b]);
+			}
+			column[r] = magnitude <= 0 ? 0 : ofClamp((20 * log10f(magnitude) + OFXTL_SPECTROGRAM_DECIBELS) * 255 / OFXTL_SPECTROGRAM_DECIBELS, 0, 255);
+		}
+		
+		lock();
+		memcpy(&levels[0][c*OFXTL_SPECTROGRAM_ROWS], column, OFXTL_SPECTROGRAM_ROWS);
+		//fold the column into the coarser levels as it goes
+		int levelColumn = c;
+		for(int l = 1; l < levels.size(); l++){
+			levelColumn /= OFXTL_SPECTROGRAM_LEVEL_SCALE;
+			unsigned char* merged = &levels[l][levelColumn*OFXTL_SPECTROGRAM_ROWS];
+			for(int r = 0; r < OFXTL_SPECTROGRAM_ROWS; r++){
+				merged[r] = MAX(merged[r], column[r]);
+			}
+		}
+		columnsAnalyzed = c+1;
+		unlock();
+	}
+}
+
+ofTexture* ofxTLSpectrogram::getTileTexture(int level, int index){
+	lock();
+	int columns = ofClamp(getColumnsReady(level) - index * OFXTL_SPECTROGRAM_TILE_COLUMNS, 0, OFXTL_SPECTROGRAM_TILE_COLUMNS);
+	unlock();
+	if(columns == 0){
+		return NULL;
+	}
+	
+	//the tile if it's already up, otherwise the one drawn longest ago
+	Tile* tile = &tiles[0];
+	for(int i = 0; i < tiles.size(); i++){
+		if(tiles[i].level == level && tiles[i].index == index){
+			tile = &tiles[i];
+			break;
+		}
+		if(tiles[i].lastUsed < tile->lastUsed){
+			tile = &tiles[i];
+		}
+	}
+	tile->lastUsed = ++tileUseCount;
+	if(tile->level == level && tile->index == index && tile->columnsLoaded == columns){
+		return tile->texture;
+	}
+	
+	//texture rows are spectrogram rows with the low frequencies at the bottom
+	lock();
+	unsigned char* source = &levels[level][index * OFXTL_SPECTROGRAM_TILE_COLUMNS * OFXTL_SPECTROGRAM_ROWS];
+	for(int r = 0; r < OFXTL_SPECTROGRAM_ROWS; r++){
+		unsigned char* row = &tilePixels[r * OFXTL_SPECTROGRAM_TILE_COLUMNS];
+		int sourceRow = OFXTL_SPECTROGRAM_ROWS - 1 - r;
+		for(int c = 0; c < OFXTL_SPECTROGRAM_TILE_COLUMNS; c++){
+			row[c] = c < columns ? source[c * OFXTL_SPECTROGRAM_ROWS + sourceRow] : 0;
+		}
+	}
+	unlock();
+	
+	if(tile->texture == NULL){
+		tile->texture = new ofTexture();
+		tile->texture->allocate(OFXTL_SPECTROGRAM_TILE_COLUMNS, OFXTL_SPECTROGRAM_ROWS, GL_LUMINANCE);
+	}
+	tile->texture->loadData(&tilePixels[0], OFXTL_SPECTROGRAM_TILE_COLUMNS, OFXTL_SPECTROGRAM_ROWS, GL_LUMINANCE);
+	tile->level = level;
+	tile->index = index;
+	tile->columnsLoaded = columns;
+	return tile->texture;
+}
+
+void ofxTLSpectrogram::draw(ofRectangle bounds, double startFrame, double endFrame){
+	if(player == NULL || bounds.width <= 0 || endFrame <= startFrame){
+		return;
+	}
+	
+	//the finest level whose columns are still at least a pixel wide keeps the tiles on screen few
+	double framesPerPixel = (endFrame - startFrame) / bounds.width;
+	int level = 0;
+	while(level+1 < levels.size() && getFramesPerColumn(level) < framesPerPixel){
+		level++;
+	}
+	
+	double framesPerTile = double(getFramesPerColumn(level)) * OFXTL_SPECTROGRAM_TILE_COLUMNS;
+	int levelColumns = levels[level].size() / OFXTL_SPECTROGRAM_ROWS;
+	int numTiles = (levelColumns + OFXTL_SPECTROGRAM_TILE_COLUMNS - 1) / OFXTL_SPECTROGRAM_TILE_COLUMNS;
+	int firstTile = MAX(floor(startFrame / framesPerTile), 0.0);
+	int lastTile = MIN(floor(endFrame / framesPerTile), numTiles - 1.0);
+	for(int t = firstTile; t <= lastTile; t++){
+		ofTexture* texture = getTileTexture(level, t);
+		if(texture != NULL){
+			float x = bounds.x + (t * framesPerTile - startFrame) / framesPerPixel;
+			texture->draw(x, bounds.y, framesPerTile / framesPerPixel, bounds.height);
+		}
+	}
+}
+
 ofxTLAudioTrack::ofxTLAudioTrack(){
 	shouldRecomputePreview = false;
     soundLoaded = false;
@@ -41,18 +660,42 @@ ofxTLAudioTrack::ofxTLAudioTrack(){
 	lastFFTPosition = -1;
 	defaultSpectrumBandwidth = 1024;
 	maxBinReceived = 0;
+	fftAnalysisRequested = false;
+	drawSpectrogram = false;
 }
 
 ofxTLAudioTrack::~ofxTLAudioTrack(){
+	fftCache.clear();
+	spectrogram.clear();
 
 }
 
-bool ofxTLAudioTrack::loadSoundfile(string filepath){
+bool ofxTLAudioTrack::loadSoundfile(string filepath, bool streamFromDisk){
 	soundLoaded = false;
-	if(player.loadSound(filepath, false)){
+	//the analysis threads read from the player
+	fftCache.clear();
+	spectrogram.clear();
+	if(player.loadSound(filepath, streamFromDisk)){
     	soundLoaded = true;
 		soundFilePath = filepath;
 		shouldRecomputePreview = true;
+		if(player.getIsStreaming()){
+			//summarize the file a chunk at a time so it's never decoded all at once
+			waveform.begin(player.getNumChannels(), player.getNumFrames());
+			vector<short> frames;
+			for(long f = 0; f < player.getNumFrames(); f += OFXTL_WAVEFORM_STREAM_FRAMES){
+				int count = MIN(long(OFXTL_WAVEFORM_STREAM_FRAMES), player.getNumFrames() - f);
+				player.readFrames(f, count, frames);
+				waveform.addFrames(&frames[0], count);
+			}
+			waveform.finish();
+		}
+		else{
+			waveform.build(player.getBuffer(), player.getNumChannels());
+		}
+		if(drawSpectrogram){
+			spectrogram.setup(&player);
+		}
         player.getSpectrum(defaultSpectrumBandwidth);
         setFFTLogAverages();
         averageSize = player.getAverages().size();
@@ -102,7 +745,7 @@ void ofxTLAudioTrack::update(){
  
 void ofxTLAudioTrack::draw(){
 	
-	if(!soundLoaded || player.getBuffer().size() == 0){
+	if(!soundLoaded || player.getNumFrames() == 0){
 		ofPushStyle();
 		ofSetColor(timeline->getColors().disabledColor);
 		ofRectangle(bounds);
@@ -110,23 +753,34 @@ void ofxTLAudioTrack::draw(){
 		return;
 	}
 		
-	if(shouldRecomputePreview || viewIsDirty){
-//		cout << "recomputing waveform for audio file " << getSoundfilePath() << endl;
-		recomputePreview();
+	if(drawSpectrogram){
+		//the spectrogram is in frames of the sound, the view in normalized timeline time
+		ofPushStyle();
+		ofSetColor(timeline->getColors().keyColor);
+		double framesPerNormalized = timeline->getDurationInSeconds() / player.getDuration() * player.getNumFrames();
+		spectrogram.draw(bounds, screenXtoNormalizedX(bounds.x) * framesPerNormalized,
+						 screenXtoNormalizedX(bounds.x+bounds.width) * framesPerNormalized);
+		ofPopStyle();
 	}
+	else{
+		if(shouldRecomputePreview || viewIsDirty){
+//			cout << "recomputing waveform for audio file " << getSoundfilePath() << endl;
+			recomputePreview();
+		}
 
-    ofPushStyle();
-    ofSetColor(timeline->getColors().keyColor);
-    ofNoFill();
-    
-    for(int i = 0; i < previews.size(); i++){
-        ofPushMatrix();
-        ofTranslate( normalizedXtoScreenX(computedZoomBounds.min, zoomBounds) - normalizedXtoScreenX(zoomBounds.min, zoomBounds), 0, 0);
-        ofScale(computedZoomBounds.span()/zoomBounds.span(), 1, 1);
-        previews[i].draw();
-        ofPopMatrix();
-    }
-    ofPopStyle();
+		ofPushStyle();
+		ofSetColor(timeline->getColors().keyColor);
+		ofNoFill();
+		
+		for(int i = 0; i < previews.size(); i++){
+			ofPushMatrix();
+			ofTranslate( normalizedXtoScreenX(computedZoomBounds.min, zoomBounds) - normalizedXtoScreenX(zoomBounds.min, zoomBounds), 0, 0);
+			ofScale(computedZoomBounds.span()/zoomBounds.span(), 1, 1);
+			previews[i].draw();
+			ofPopMatrix();
+		}
+		ofPopStyle();
+	}
 	
 
     
@@ -162,14 +816,22 @@ void ofxTLAudioTrack::recomputePreview(){
 	
 	float normalizationRatio = timeline->getDurationInSeconds() / player.getDuration(); //need to figure this out for framebased...but for now we are doing time based
 	float trackHeight = bounds.height/(1+player.getNumChannels());
-	int numSamples = player.getBuffer().size() / player.getNumChannels();
-	int pixelsPerSample = numSamples / bounds.width;
+	long numSamples = player.getNumFrames();
 	int numChannels = player.getNumChannels();
-	vector<short> & buffer  = player.getBuffer();
+	//pick the pyramid level once for the whole view, every pixel covers the same number of frames
+	double framesPerPixel = (screenXtoNormalizedX(bounds.x+1) - screenXtoNormalizedX(bounds.x)) * normalizationRatio * numSamples;
+	int level = waveform.getLevelForFramesPerPixel(framesPerPixel);
+	vector<short> & buffer = player.getIsStreaming() ? previewFrames : player.getBuffer();
+	long bufferStartFrame = 0;
+	if(level < 0 && player.getIsStreaming()){
+		//zoomed in past the pyramid, only the frames on screen are read off disk
+		bufferStartFrame = MAX(long(screenXtoNormalizedX(bounds.x) * normalizationRatio * numSamples - framesPerPixel) - 1, 0L);
+		long bufferEndFrame = MIN(long(screenXtoNormalizedX(bounds.x+bounds.width) * normalizationRatio * numSamples) + 1, numSamples);
+		player.readFrames(bufferStartFrame, bufferEndFrame - bufferStartFrame, previewFrames);
+	}
 
 	for(int c = 0; c < numChannels; c++){
 		ofPolyline preview;
-		int lastFrameIndex = 0;
 		preview.resize(bounds.width*2);  //Why * 2? Because there are two points per pixel, center and outside. 
 		for(float i = bounds.x; i < bounds.x+bounds.width; i++){
 			float pointInTrack = screenXtoNormalizedX( i ) * normalizationRatio; //will scale the screenX into wave's 0-1.0
@@ -178,20 +840,13 @@ void ofxTLAudioTrack::recomputePreview(){
 			ofPoint * vertex = & preview.getVertices()[ (i - bounds.x) * 2];
 			
 			if(pointInTrack >= 0 && pointInTrack <= 1.0){
-				//draw sample at pointInTrack * waveDuration;
-				int frameIndex = pointInTrack * numSamples;					
-				float losample = 0;
-				float hisample = 0;
-				for(int f = lastFrameIndex; f < frameIndex; f++){
-					int sampleIndex = f * numChannels + c;
-					float subpixelSample = buffer[sampleIndex]/32565.0;
-					if(subpixelSample < losample) {
-						losample = subpixelSample;
-					}
-					if(subpixelSample > hisample) {
-						hisample = subpixelSample;
-					}
-				}
+				//draw the frames from the one before this pixel up to this one
+				int frameIndex = pointInTrack * numSamples;
+				int lastFrameIndex = MAX(frameIndex - framesPerPixel, 0.0);
+				short low, high;
+				waveform.getRange(buffer, bufferStartFrame, level, c, lastFrameIndex, frameIndex, low, high);
+				float losample = MIN(low/32565.0, 0.0);
+				float hisample = MAX(high/32565.0, 0.0);
 				
 				if(losample == 0 && hisample == 0){
 					//preview.addVertex(i, trackCenter);
@@ -219,8 +874,6 @@ void ofxTLAudioTrack::recomputePreview(){
 					*vertex = *(vertex-1);
 					vertex++;
 				}
-
-				lastFrameIndex = frameIndex;
 			}
 			else{
 				*vertex++ = ofPoint(i,trackCenter);
@@ -257,7 +910,8 @@ void ofxTLAudioTrack::zoomStarted(ofxTLZoomEventArgs& args){
 
 void ofxTLAudioTrack::zoomDragged(ofxTLZoomEventArgs& args){
 	ofxTLTrack::zoomDragged(args);
-	//shouldRecomputePreview = true;
+	//cheap enough with the waveform pyramid to keep up with the drag
+	shouldRecomputePreview = true;
 }
 
 void ofxTLAudioTrack::zoomEnded(ofxTLZoomEventArgs& args){
@@ -378,6 +1032,9 @@ float ofxTLAudioTrack::getFFTDampening(){
 void ofxTLAudioTrack::setFFTLogAverages(int minBandwidth, int bandsPerOctave){
     if(isSoundLoaded()){
         player.setLogAverages(minBandwidth, bandsPerOctave);
+        if(fftAnalysisRequested){
+            analyzeFFT();
+        }
     }
 }
 
@@ -439,7 +1096,7 @@ vector<float>& ofxTLAudioTrack::getFFT(){
 
 int ofxTLAudioTrack::getBufferSize()
 {
-    return player.getBuffer().size() / player.getNumChannels();
+    return player.getNumFrames();
 }
 
 vector<float>& ofxTLAudioTrack::getCurrentBuffer(int _size)
@@ -459,6 +1116,86 @@ vector<float>& ofxTLAudioTrack::getBufferForFrame(int _frame, int _size)
     return buffered;
 }
 
+void ofxTLAudioTrack::analyzeFFT(){
+    fftAnalysisRequested = true;
+    if(!isSoundLoaded() || timeline == NULL){
+        return;
+    }
+    float fps = timeline->getTimecode().getFPS();
+    if(!fftCache.isSetup(fps, defaultSpectrumBandwidth, player.getMinBandwidth(), player.getBandsPerOctave())){
+        fftCache.setup(&player, ofToDataPath(soundFilePath, true), ofToDataPath(timeline->getWorkingFolder() + "fftcache/", true),
+                       fps, defaultSpectrumBandwidth, player.getMinBandwidth(), player.getBandsPerOctave());
+    }
+}
+
+bool ofxTLAudioTrack::isFFTAnalyzed(){
+    return timeline != NULL &&
+        fftCache.isSetup(timeline->getTimecode().getFPS(), defaultSpectrumBandwidth, player.getMinBandwidth(), player.getBandsPerOctave()) &&
+        fftCache.isReady();
+}
+
+float ofxTLAudioTrack::getFFTAnalysisProgress(){
+    return fftCache.getProgress();
+}
+
+vector<float>& ofxTLAudioTrack::getFFTForFrame(int frame){
+    if(!isSoundLoaded() || timeline == NULL){
+        frameFFT.clear();
+        return frameFFT;
+    }
+    
+    float fps = timeline->getTimecode().getFPS();
+    if(!fftCache.isSetup(fps, defaultSpectrumBandwidth, player.getMinBandwidth(), player.getBandsPerOctave()) ||
+       !fftCache.getFrame(frame, frameFFT))
+    {
+        //not cached yet, analyze it here exactly like the cache would
+        frameAnalyzer.setup(defaultSpectrumBandwidth, player.getSampleRate(), player.getMinBandwidth(), player.getBandsPerOctave());
+        player.readFrames(long(frame * double(player.getSampleRate()) / fps), frameAnalyzer.getSignalSize(), frameSamples);
+        frameAnalyzer.analyze(frameSamples, player.getNumChannels(), frameFFT);
+        fftCache.quantize(frameFFT);
+    }
+    
+    //same shaping as getFFT, minus the dampening which depends on the frames before
+    if(getUseFFTEnvelope()){
+        if(envelope.size() != frameFFT.size()){
+            generateEnvelope(frameFFT.size());
+        }
+        for(int i = 0; i < frameFFT.size(); i++){
+            frameFFT[i] *= envelope[i];
+        }
+    }
+    float max = 0;
+    for(int i = 0; i < frameFFT.size(); i++){
+        max = MAX(max, frameFFT[i]);
+    }
+    if(max != 0){
+        for(int i = 0; i < frameFFT.size(); i++){
+            frameFFT[i] = ofMap(frameFFT[i], 0, max, 0, 1.0);
+        }
+    }
+    return frameFFT;
+}
+
+vector<float>& ofxTLAudioTrack::getFFTAtMillis(long millis){
+    if(timeline == NULL){
+        frameFFT.clear();
+        return frameFFT;
+    }
+    return getFFTForFrame(millis * timeline->getTimecode().getFPS() / 1000.0);
+}
+
+void ofxTLAudioTrack::setDrawSpectrogram(bool shouldDraw){
+    drawSpectrogram = shouldDraw;
+    if(drawSpectrogram && isSoundLoaded() && !spectrogram.isSetup()){
+        spectrogram.setup(&player);
+    }
+    shouldRecomputePreview = true;
+}
+
+bool ofxTLAudioTrack::getDrawSpectrogram(){
+    return drawSpectrogram;
+}
+
 void ofxTLAudioTrack::generateEnvelope(int size){
     envelope.clear();
     
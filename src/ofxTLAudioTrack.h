@@ -36,6 +36,141 @@
 #include "ofxTLTrack.h"
 #include "ofOpenALSoundPlayer_TimelineAdditions.h"
 
+//min and max of every channel over buckets of 256, 4096 and 65536 frames,
+//built once when a sound loads so the waveform preview reads about one bucket
+//per pixel at any zoom instead of every sample underneath it
+class ofxTLWaveformPyramid {
+  public:
+	ofxTLWaveformPyramid();
+	
+	struct Bucket {
+		short min;
+		short max;
+	};
+	
+	void build(vector<short>& buffer, int numChannels);
+	//or a piece at a time, for sounds streamed from disk
+	void begin(int numChannels, long numFrames);
+	void addFrames(const short* frames, int count);
+	void finish();
+	void clear();
+	int getNumLevels();
+	int getFramesPerBucket(int level);
+	//the coarsest level whose buckets still fit inside a pixel, or -1 when zoomed in
+	//far enough that the raw samples are cheaper
+	int getLevelForFramesPerPixel(double framesPerPixel);
+	//min and max of one channel over frames startFrame up to but not including endFrame,
+	//read from the level's buckets or for level -1 from raw frames starting at bufferStartFrame
+	void getRange(vector<short>& buffer, long bufferStartFrame, int level, int channel, long startFrame, long endFrame, short& low, short& high);
+	
+	int numChannels;
+	long numFrames;
+	long framesAdded;
+	//levels[l][bucket*numChannels + channel]
+	vector< vector<Bucket> > levels;
+};
+
+//log averaged fft bands for every timeline frame of a sound, analyzed on a background thread
+//and saved to disk keyed by the file's hash and the fft settings, so audio reactive renders
+//come out the same every run no matter how fast they go
+class ofxTLFFTCache : public ofThread {
+  public:
+	ofxTLFFTCache();
+	virtual ~ofxTLFFTCache();
+	
+	//loads a matching cache from cacheFolder or analyzes the sound and saves one
+	void setup(ofOpenALSoundPlayer_TimelineAdditions* player, string soundPath, string cacheFolder,
+			   float fps, int bands, int minBandwidth, int bandsPerOctave);
+	void clear();
+	
+	bool isSetup(float fps, int bands, int minBandwidth, int bandsPerOctave);
+	bool isReady();
+	float getProgress();
+	int getNumFrames();
+	string getCachePath();
+	
+	//false until the frame has been analyzed
+	bool getFrame(int frame, vector<float>& averages);
+	//rounds averages to what the cache stores, so frames analyzed elsewhere match cached ones
+	void quantize(vector<float>& averages);
+	
+  protected:
+	void threadedFunction();
+	bool load();
+	void save();
+	void encode(vector<float>& averages, float& max, unsigned char* quantized);
+	void decode(float max, unsigned char* quantized, vector<float>& averages);
+	
+	ofOpenALSoundPlayer_TimelineAdditions* player;
+	//the thread's own chunks of a streamed sound
+	ofSoundFileWindow_TimelineAdditions window;
+	string soundPath;
+	string cacheFolder;
+	string cachePath;
+	float fps;
+	int bands;
+	int minBandwidth;
+	int bandsPerOctave;
+	unsigned long long fileHash;
+	
+	int numFrames;
+	int numAverages;
+	int framesAnalyzed;
+	bool ready;
+	
+	//each frame is stored as its loudest band and every band in 8 bit decibels below that
+	vector<float> frameMax;
+	vector<unsigned char> frameBands;
+	float decibelTable[256];
+};
+
+//short time fft of the whole sound as 8 bit columns, analyzed on a background thread into
+//levels that merge columns like the waveform pyramid. only the tiles on screen are uploaded,
+//so panning and zooming draw textures and never run an fft
+class ofxTLSpectrogram : public ofThread {
+  public:
+	ofxTLSpectrogram();
+	virtual ~ofxTLSpectrogram();
+	
+	void setup(ofOpenALSoundPlayer_TimelineAdditions* player);
+	void clear();
+	bool isSetup();
+	float getProgress();
+	
+	//draws frames startFrame to endFrame of the sound stretched across bounds
+	void draw(ofRectangle bounds, double startFrame, double endFrame);
+	
+  protected:
+	void threadedFunction();
+	int getFramesPerColumn(int level);
+	//columns of a level that won't change any more, call with the lock held
+	int getColumnsReady(int level);
+	ofTexture* getTileTexture(int level, int index);
+	
+	struct Tile {
+		int level;
+		int index;
+		int columnsLoaded;
+		unsigned long lastUsed;
+		ofTexture* texture;
+	};
+	
+	ofOpenALSoundPlayer_TimelineAdditions* player;
+	//the thread's own chunks of a streamed sound
+	ofSoundFileWindow_TimelineAdditions window;
+	int numColumns;
+	int columnsAnalyzed;
+	//levels[l][column*rows + row], loudness in decibels from 0 to 255
+	vector< vector<unsigned char> > levels;
+	//the fft bins under each row, rows are spaced logarithmically
+	vector<int> rowLow;
+	vector<int> rowHigh;
+	
+	vector<Tile> tiles;
+	unsigned long tileUseCount;
+	vector<unsigned char> tilePixels;
+};
+
 class ofxTLAudioTrack : public ofxTLTrack
 {
   public:	
@@ -45,7 +180,8 @@ class ofxTLAudioTrack : public ofxTLTrack
 	virtual void draw();
 	virtual void update();
 	
-	virtual bool loadSoundfile(string filepath);
+	//streamFromDisk keeps only a window of the file and the waveform summary in memory
+	virtual bool loadSoundfile(string filepath, bool streamFromDisk = false);
 	virtual bool isSoundLoaded();
 	virtual float getDuration(); //in seconds
 	virtual string getSoundfilePath();
@@ -98,6 +234,18 @@ class ofxTLAudioTrack : public ofxTLTrack
     vector<float> &getCurrentBuffer(int _size = 512);
     vector<float> &getBufferForFrame(int _frame, int _size = 512);
 
+    //deterministic FFT for offline rendering, read from a cache the timeline analyzes in the background
+    //frames that aren't cached yet are analyzed on the spot with the same result
+    void analyzeFFT();
+    bool isFFTAnalyzed();
+    float getFFTAnalysisProgress();
+    vector<float>& getFFTForFrame(int frame);
+    vector<float>& getFFTAtMillis(long millis);
+
+    //draws a spectrogram instead of the waveform, analyzed in the background the first time
+    void setDrawSpectrogram(bool shouldDraw);
+    bool getDrawSpectrogram();
+
   protected:
 	
 	float positionForSecond(float second);
@@ -105,6 +253,8 @@ class ofxTLAudioTrack : public ofxTLTrack
 	bool shouldRecomputePreview;
 	vector<ofPolyline> previews;
 	void recomputePreview();
+	ofxTLWaveformPyramid waveform;
+	vector<short> previewFrames;
 	string soundFilePath;
 	float lastFFTPosition;
     float lastBufferPosition;
@@ -121,6 +271,14 @@ class ofxTLAudioTrack : public ofxTLTrack
 	float maxBinReceived;
     float dampening;
 
+    ofxTLFFTCache fftCache;
+    ofxTLSpectrogram spectrogram;
+    bool drawSpectrogram;
+    bool fftAnalysisRequested;
+    ofFFTAnalyzer_TimelineAdditions frameAnalyzer;
+    vector<short> frameSamples;
+    vector<float> frameFFT;
+
     void generateEnvelope(int size);
     int averageSize;
     bool useEnvelope;
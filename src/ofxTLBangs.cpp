@@ -36,6 +36,12 @@
 ofxTLBangs::ofxTLBangs(){
     lastTimelinePoint = 0;
 	lastBangTime = 0;
+	bangCursor = 0;
+	bangCursorTime = -1;
+	scheduleGeneration = -1;
+	scheduleCursor = -1;
+	scheduledUntil = -1;
+	scheduleWrapped = false;
 }
 
 ofxTLBangs::~ofxTLBangs(){
@@ -85,16 +91,18 @@ void ofxTLBangs::draw(){
 }
 
 void ofxTLBangs::regionSelected(ofLongRange timeRange, ofRange valueRange){
-    for(int i = 0; i < keyframes.size(); i++){
-    	if(timeRange.contains( keyframes[i]->time )){
-            selectKeyframe(keyframes[i]);
-        }
+	int startIndex, endIndex;
+	getKeyIndicesInRange(timeRange, startIndex, endIndex);
+    for(int i = startIndex; i < endIndex; i++){
+		selectKeyframe(keyframes[i]);
 	}
 }
 
 ofxTLKeyframe* ofxTLBangs::keyframeAtScreenpoint(ofVec2f p){
     if(bounds.inside(p.x, p.y)){
-        for(int i = 0; i < keyframes.size(); i++){
+		int startIndex, endIndex;
+		getKeyIndicesNearScreenX(p.x, 5, startIndex, endIndex);
+        for(int i = startIndex; i < endIndex; i++){
             float offset = p.x - timeline->millisToScreenX(keyframes[i]->time);            
             if (abs(offset) < 5) {
                 return keyframes[i];
@@ -107,21 +115,111 @@ ofxTLKeyframe* ofxTLBangs::keyframeAtScreenpoint(ofVec2f p){
 void ofxTLBangs::update(){
 //	if(isPlaying || timeline->getIsPlaying()){
 		long thisTimelinePoint = currentTrackTime();
-		for(int i = 0; i < keyframes.size(); i++){
-			if(timeline->getInOutRangeMillis().contains(keyframes[i]->time) &&
-               lastTimelinePoint <= keyframes[i]->time &&
-               thisTimelinePoint >= keyframes[i]->time &&
-               thisTimelinePoint != lastTimelinePoint)
-            {
-//				ofLogNotice() << "fired bang with accuracy of " << (keyframes[i]->time - thisTimelinePoint) << endl;
-				bangFired(keyframes[i]);
-				lastBangTime = ofGetElapsedTimef();
+		if(timeline->getBangSchedulingEnabled() && timeline->getIsPlaying() && !isPlaying){
+			scheduleBangs(thisTimelinePoint);
+		}
+		else if(thisTimelinePoint > lastTimelinePoint){
+			scheduleGeneration = -1;
+			ofxTLKeyframeStore& store = getKeyStore();
+			//carrying on from the last update the cursor is already past the bangs fired then,
+			//otherwise fire anything from lastTimelinePoint on, including a bang right on it
+			int bang = bangCursor;
+			if(bangCursorTime != lastTimelinePoint || bang > store.size() ||
+			   (bang > 0 && store.times[bang-1] > bangCursorTime) ||
+			   (bang < store.size() && store.times[bang] <= bangCursorTime))
+			{
+				bang = lower_bound(store.times.begin(), store.times.end(), (unsigned long long)MAX(lastTimelinePoint, 0L)) - store.times.begin();
+			}
+			
+			ofLongRange inOutRange = timeline->getInOutRangeMillis();
+			for(; bang < store.size() && store.times[bang] <= thisTimelinePoint; bang++){
+				if(inOutRange.contains(store.times[bang])){
+//					ofLogNotice() << "fired bang with accuracy of " << (store.times[bang] - thisTimelinePoint) << endl;
+					//scrubbing while scheduling still goes through the queue, due straight away
+					if(timeline->getBangSchedulingEnabled()){
+						bangScheduled(store.keys[bang], store.times[bang], timeline->getTimer().getAppTimeSeconds());
+					}
+					else{
+						bangFired(store.keys[bang]);
+					}
+					lastBangTime = ofGetElapsedTimef();
+				}
 			}
+			bangCursor = bang;
+			bangCursorTime = thisTimelinePoint;
 		}
 		lastTimelinePoint = thisTimelinePoint;
 //	}
 }
 
+void ofxTLBangs::scheduleBangs(long thisTimelinePoint){
+	ofxTLKeyframeStore& store = getKeyStore();
+	ofLongRange inOutRange = timeline->getInOutRangeMillis();
+	double appSeconds = timeline->getTimer().getAppTimeSeconds();
+	long windowEnd = thisTimelinePoint + timeline->getBangSchedulingLookahead();
+	bool looping = timeline->getLoopType() == OF_LOOP_NORMAL;
+	
+	//the timeline dropped the queue on starting or seeking, carry on from the playhead
+	if(scheduleGeneration != timeline->getBangScheduleGeneration()){
+		scheduleGeneration = timeline->getBangScheduleGeneration();
+		scheduledUntil = MIN(lastTimelinePoint, thisTimelinePoint) - 1;
+		scheduleCursor = -1;
+		scheduleWrapped = false;
+	}
+	else if(thisTimelinePoint < lastTimelinePoint){
+		//looped into the pass that was already scheduled ahead
+		if(scheduleWrapped){
+			scheduleWrapped = false;
+		}
+		//or looped further than the lookahead, anything since the in point is due now
+		else{
+			scheduledUntil = inOutRange.min - 1;
+			scheduleCursor = -1;
+		}
+	}
+	
+	if(!scheduleWrapped){
+		scheduleBangsUntil(store, inOutRange, looping ? MIN(windowEnd, inOutRange.max) : windowEnd, appSeconds - thisTimelinePoint/1000.);
+		if(looping && windowEnd > inOutRange.max){
+			scheduledUntil = inOutRange.min - 1;
+			scheduleCursor = -1;
+			scheduleWrapped = true;
+		}
+	}
+	if(scheduleWrapped){
+		//keys on the next pass are due a whole loop later
+		long loopSpan = inOutRange.span();
+		scheduleBangsUntil(store, inOutRange, windowEnd - loopSpan, appSeconds + (loopSpan - thisTimelinePoint)/1000.);
+	}
+}
+
+void ofxTLBangs::scheduleBangsUntil(ofxTLKeyframeStore& store, ofLongRange inOutRange, long until, double appSecondsAtZero){
+	if(until <= scheduledUntil){
+		return;
+	}
+	
+	int bang = scheduleCursor;
+	if(bang < 0 || bang > store.size() ||
+	   (bang > 0 && store.times[bang-1] > scheduledUntil) ||
+	   (bang < store.size() && store.times[bang] <= scheduledUntil))
+	{
+		bang = lower_bound(store.times.begin(), store.times.end(), (unsigned long long)MAX(scheduledUntil+1, 0L)) - store.times.begin();
+	}
+	
+	for(; bang < store.size() && store.times[bang] <= until; bang++){
+		if(inOutRange.contains(store.times[bang])){
+			bangScheduled(store.keys[bang], store.times[bang], appSecondsAtZero + store.times[bang]/1000.);
+			lastBangTime = ofGetElapsedTimef();
+		}
+	}
+	scheduleCursor = bang;
+	scheduledUntil = until;
+}
+
+void ofxTLBangs::bangScheduled(ofxTLKeyframe* key, long millis, double appSeconds){
+	timeline->scheduleBang(this, millis, appSeconds, "");
+}
+
 void ofxTLBangs::bangFired(ofxTLKeyframe* key){
     ofxTLBangEventArgs args;
     args.sender = timeline;
@@ -58,6 +58,19 @@ class ofxTLBangs : public ofxTLKeyframes {
 	
     long lastTimelinePoint;
 	float lastBangTime; //just for display
+	//index of the first key after bangCursorTime, where the last update stopped.
+	//seeks, loops and edits leave it out of step and it's searched for again
+	int bangCursor;
+	long bangCursorTime;
 	
     virtual void bangFired(ofxTLKeyframe* key);
+	
+	//see ofxTimeline::enableBangScheduling()
+	virtual void scheduleBangs(long thisTimelinePoint);
+	virtual void scheduleBangsUntil(ofxTLKeyframeStore& store, ofLongRange inOutRange, long until, double appSecondsAtZero);
+	virtual void bangScheduled(ofxTLKeyframe* key, long millis, double appSeconds);
+	int scheduleGeneration;
+	int scheduleCursor; //first key after scheduledUntil
+	long scheduledUntil;
+	bool scheduleWrapped; //scheduledUntil is on the next pass around the loop
 };
\ No newline at end of file
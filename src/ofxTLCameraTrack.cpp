@@ -51,6 +51,114 @@ ofVec3f ofHermiteInterpolate(ofVec3f y0, ofVec3f y1, ofVec3f y2, ofVec3f y3, flo
 	return(a0*y1 + a1*m0+a2*m1+a3*y2);
 }
 
+void ofxTLCameraStore::clear(){
+	ofxTLKeyframeStore::clear();
+	positions.clear();
+	orientations.clear();
+	easeIns.clear();
+	easeOuts.clear();
+	segments.clear();
+}
+
+void ofxTLCameraStore::reserve(int numKeys){
+	ofxTLKeyframeStore::reserve(numKeys);
+	positions.reserve(numKeys);
+	orientations.reserve(numKeys);
+	easeIns.reserve(numKeys);
+	easeOuts.reserve(numKeys);
+}
+
+void ofxTLCameraStore::push(ofxTLKeyframe* key){
+	ofxTLKeyframeStore::push(key);
+	ofxTLCameraFrame* frame = (ofxTLCameraFrame*)key;
+	positions.push_back(frame->position);
+	orientations.push_back(frame->orientation);
+	easeIns.push_back(frame->easeIn);
+	easeOuts.push_back(frame->easeOut);
+}
+
+void ofxTLCameraStore::finish(){
+	int numKeys = size();
+	//keys only get appended after a finish, which changes the old last segment's
+	//outgoing tangent and adds new ones after it. everything before is still good
+	int firstChanged = MAX((int)segments.size()-1, 0);
+	segments.resize(MAX(numKeys-1, 0));
+	for(int s = firstChanged; s < numKeys-1; s++){
+		Segment& segment = segments[s];
+		unsigned long long span = times[s+1] - times[s];
+		segment.invSpan = span > 0 ? 1.0 / span : 0;
+		
+		//same easing choices as interpolateBetween
+		segment.cut = easeOuts[s] == OFXTL_CAMERA_EASE_CUT || easeIns[s+1] == OFXTL_CAMERA_EASE_CUT;
+		segment.ease = NULL;
+		if(easeOuts[s] == OFXTL_CAMERA_EASE_SMOOTH && easeIns[s+1] == OFXTL_CAMERA_EASE_LINEAR){
+			segment.ease = ofxTLInterpolationKernels::functionForType<ofxEasingQuad>(ofxTween::easeIn);
+		}
+		else if(easeOuts[s] == OFXTL_CAMERA_EASE_LINEAR && easeIns[s+1] == OFXTL_CAMERA_EASE_SMOOTH){
+			segment.ease = ofxTLInterpolationKernels::functionForType<ofxEasingQuad>(ofxTween::easeOut);
+		}
+		else if(easeOuts[s] == OFXTL_CAMERA_EASE_SMOOTH && easeIns[s+1] == OFXTL_CAMERA_EASE_SMOOTH){
+			segment.ease = ofxTLInterpolationKernels::functionForType<ofxEasingQuad>(ofxTween::easeInOut);
+		}
+		
+		//ofHermiteInterpolate with no tension or bias, expanded into powers of alpha
+		ofVec3f& y0 = positions[s > 0 ? s-1 : s];
+		ofVec3f& y1 = positions[s];
+		ofVec3f& y2 = positions[s+1];
+		ofVec3f& y3 = positions[s+2 < numKeys ? s+2 : s+1];
+		ofVec3f m0 = (y2-y0)*.5;
+		ofVec3f m1 = (y3-y1)*.5;
+		segment.a = y1;
+		segment.b = m0;
+		segment.c = (y2-y1)*3 - m0*2 - m1;
+		segment.d = (y1-y2)*2 + m0 + m1;
+		
+		//the constant part of ofQuaternion::slerp
+		segment.from = orientations[s];
+		segment.to = orientations[s+1];
+		double cosOmega = segment.from.asVec4().dot(segment.to.asVec4());
+		if(cosOmega < 0){
+			cosOmega = -cosOmega;
+			segment.to = -segment.to;
+		}
+		if(1.0 - cosOmega > 0.00001){
+			segment.omega = acos(cosOmega);
+			segment.invSinOmega = 1.0 / sin(segment.omega);
+		}
+		else{
+			segment.omega = 0;
+			segment.invSinOmega = 0;
+		}
+	}
+}
+
+void ofxTLCameraStore::evaluate(int s, unsigned long long millis, ofVec3f& position, ofQuaternion& orientation){
+	Segment& segment = segments[s];
+	float alpha = 0;
+	if(!segment.cut){
+		if(segment.ease == NULL){
+			//may run outside 0-1 for times outside the segment, like ofMap without clamping
+			alpha = ((double)millis - times[s]) * segment.invSpan;
+		}
+		else{
+			alpha = segment.ease((double)millis - times[s], 0, 1.0, times[s+1] - times[s]);
+		}
+	}
+	
+	position = segment.a + (segment.b + (segment.c + segment.d*alpha)*alpha)*alpha;
+	
+	double scaleFrom, scaleTo;
+	if(segment.invSinOmega != 0){
+		scaleFrom = sin((1.0 - alpha) * segment.omega) * segment.invSinOmega;
+		scaleTo = sin(alpha * segment.omega) * segment.invSinOmega;
+	}
+	else{
+		scaleFrom = 1.0 - alpha;
+		scaleTo = alpha;
+	}
+	orientation = segment.from*scaleFrom + segment.to*scaleTo;
+}
+
 ofxTLCameraTrack::ofxTLCameraTrack(){
 	camera = NULL;
 	lockCameraToTrack = false;
@@ -156,13 +264,12 @@ void ofxTLCameraTrack::draw3d(){
 		ofPopStyle();
 	}
 	
-	unsigned long long startMillis = screenXToMillis(bounds.x);
-	unsigned long long endMillis = screenXToMillis(bounds.getMaxX());
-	unsigned long long step = (endMillis - startMillis)/100;
-	for(unsigned long long millis = startMillis; millis < endMillis; millis += step ){
-		setCameraFrameToTime(&interFrame, millis);
-		n.setPosition(interFrame.position);
-		n.setOrientation(interFrame.orientation);
+	pathPositions.resize(100);
+	pathOrientations.resize(100);
+	samplePath(screenXToMillis(bounds.x), screenXToMillis(bounds.getMaxX()), pathPositions.size(), &pathPositions[0], &pathOrientations[0]);
+	for(int i = 0; i < pathPositions.size(); i++){
+		n.setPosition(pathPositions[i]);
+		n.setOrientation(pathOrientations[i]);
 		ofSetColor(0,0,255);
 		ofLine(n.getPosition(), n.getPosition() + n.getLookAtDir()*10);
 		ofSetColor(0,255,0);
@@ -318,16 +425,17 @@ void ofxTLCameraTrack::keyPressed(ofKeyEventArgs& args){
 	}
 	
 	if(modified){
+		keyStoreIsDirty = true;
 		timeline->flagTrackModified(this);
 	}
 	
 }
 
 void ofxTLCameraTrack::regionSelected(ofLongRange timeRange, ofRange valueRange){
-    for(int i = 0; i < keyframes.size(); i++){
-    	if(timeRange.contains( keyframes[i]->time )){
-            selectKeyframe(keyframes[i]);
-        }
+	int startIndex, endIndex;
+	getKeyIndicesInRange(timeRange, startIndex, endIndex);
+    for(int i = startIndex; i < endIndex; i++){
+		selectKeyframe(keyframes[i]);
 	}
 }
 
@@ -335,9 +443,13 @@ string ofxTLCameraTrack::getTrackType(){
 	return "CameraTrack";
 }
 
+ofxTLKeyframeStore* ofxTLCameraTrack::newKeyframeStore(){
+	return new ofxTLCameraStore();
+}
+
 ofxTLKeyframe* ofxTLCameraTrack::newKeyframe(){
 	//return our type of keyframe, stored in the parent class
-	ofxTLCameraFrame* newKey = new ofxTLCameraFrame();
+	ofxTLCameraFrame* newKey = allocateKeyframe<ofxTLCameraFrame>();
 	if(camera != NULL){
 		newKey->position = camera->getPosition();
 		newKey->orientation = camera->getOrientationQuat();
@@ -377,7 +489,9 @@ void ofxTLCameraTrack::storeKeyframe(ofxTLKeyframe* key, ofxXmlSettings& xmlStor
 
 ofxTLKeyframe* ofxTLCameraTrack::keyframeAtScreenpoint(ofVec2f p){
     if(bounds.inside(p.x, p.y)){
-        for(int i = 0; i < keyframes.size(); i++){
+		int startIndex, endIndex;
+		getKeyIndicesNearScreenX(p.x, bounds.height/2, startIndex, endIndex);
+        for(int i = startIndex; i < endIndex; i++){
             float offset = p.x - timeline->millisToScreenX(keyframes[i]->time);
             if (abs(offset) < bounds.height/2) {
                 return keyframes[i];
@@ -425,12 +539,51 @@ void ofxTLCameraTrack::moveCameraToTime(unsigned long long millis){
 }
 
 void ofxTLCameraTrack::setCameraFrameToTime(ofxTLCameraFrame* target, unsigned long long millis){
-	for(int i = 1; i < keyframes.size(); i++){
-		if(keyframes[i]->time > millis){
-			ofxTLCameraFrame* prev = (ofxTLCameraFrame*)(i > 2 ? keyframes[i-2] : keyframes[i-1]);
-			ofxTLCameraFrame* next = (ofxTLCameraFrame*)(i < keyframes.size()-1 ? keyframes[i+1] : keyframes[i]);
-			interpolateBetween(target, prev, (ofxTLCameraFrame*)keyframes[i-1], (ofxTLCameraFrame*)keyframes[i], next, millis);
-			break;
+	ofxTLCameraStore& store = (ofxTLCameraStore&)getKeyStore();
+	//the segment ending at the first key after millis
+	int s = upper_bound(store.times.begin(), store.times.end(), millis) - store.times.begin() - 1;
+	if(store.size() < 2 || s >= store.size()-1){
+		return;
+	}
+	target->time = millis;
+	store.evaluate(MAX(s, 0), millis, target->position, target->orientation);
+}
+
+void ofxTLCameraTrack::samplePath(unsigned long long startMillis, unsigned long long endMillis, int count, ofVec3f* positions, ofQuaternion* orientations){
+	ofxTLCameraStore& store = (ofxTLCameraStore&)getKeyStore();
+	int numKeys = store.size();
+	if(numKeys == 0){
+		return;
+	}
+	
+	ofVec3f position;
+	ofQuaternion orientation;
+	int s = 0;
+	for(int i = 0; i < count; i++){
+		unsigned long long sampleTime = rangeSampleTime(store, startMillis, endMillis, count, i);
+		if(numKeys == 1 || sampleTime <= store.times[0]){
+			position = store.positions[0];
+			orientation = store.orientations[0];
+		}
+		else if(sampleTime >= store.times[numKeys-1]){
+			position = store.positions[numKeys-1];
+			orientation = store.orientations[numKeys-1];
+		}
+		else{
+			//samples normally move forward, walk the segments along with them
+			if(sampleTime < store.times[s]){
+				s = upper_bound(store.times.begin(), store.times.end(), sampleTime) - store.times.begin() - 1;
+			}
+			while(store.times[s+1] <= sampleTime){
+				s++;
+			}
+			store.evaluate(s, sampleTime, position, orientation);
+		}
+		if(positions != NULL){
+			positions[i] = position;
+		}
+		if(orientations != NULL){
+			orientations[i] = orientation;
 		}
 	}
 }
@@ -34,6 +34,7 @@
 
 #include "ofMain.h"
 #include "ofxTLKeyframes.h"
+#include "ofxTLInterpolationKernels.h"
 typedef enum {
     OFXTL_CAMERA_EASE_LINEAR,
     OFXTL_CAMERA_EASE_SMOOTH,
@@ -53,6 +54,37 @@ class ofxTLCameraFrame : public ofxTLKeyframe {
 	bool easeInSelected;
 };
 
+//each key's pose packed beside the times of the store, plus the interpolation
+//from every key to the next worked out once when the store is built
+class ofxTLCameraStore : public ofxTLKeyframeStore {
+  public:
+	virtual void clear();
+	virtual void reserve(int numKeys);
+	virtual void push(ofxTLKeyframe* key);
+	virtual void finish();
+	
+	struct Segment {
+		bool cut; //holds the first pose until the next key
+		ofxTLEasingFunction ease; //NULL when linear
+		double invSpan;
+		//the hermite spline through the neighbouring keys as a cubic in the eased alpha
+		ofVec3f a, b, c, d;
+		//slerp between the two orientations, the second flipped onto the same hemisphere
+		ofQuaternion from, to;
+		double omega;
+		double invSinOmega; //0 when they're close enough to blend linearly
+	};
+	
+	//pose at a time inside segment s, from key s to key s+1
+	void evaluate(int s, unsigned long long millis, ofVec3f& position, ofQuaternion& orientation);
+	
+	vector<ofVec3f> positions;
+	vector<ofQuaternion> orientations;
+	vector<CameraTrackEase> easeIns;
+	vector<CameraTrackEase> easeOuts;
+	vector<Segment> segments;
+};
+
 //Just a simple useless random color keyframer
 //to show how to create a custom keyframer
 class ofxTLCameraTrack : public ofxTLKeyframes {
@@ -100,6 +132,11 @@ class ofxTLCameraTrack : public ofxTLKeyframes {
 	//return a custom name for this keyframe
 	virtual string getTrackType();
 
+	//poses at count evenly spaced times from startMillis to endMillis, for path previews,
+	//offline rendering and motion blur. either output can be NULL.
+	//times before the first key or after the last hold that key's pose
+	void samplePath(unsigned long long startMillis, unsigned long long endMillis, int count, ofVec3f* positions, ofQuaternion* orientations);
+
   protected:
 	ofCamera* camera;
 	
@@ -117,6 +154,11 @@ class ofxTLCameraTrack : public ofxTLKeyframes {
 	void moveCameraToPosition(ofxTLCameraFrame* target);
 	
 	void update(ofEventArgs& args);
+	
+	virtual ofxTLKeyframeStore* newKeyframeStore();
+	//drawn by draw3d
+	vector<ofVec3f> pathPositions;
+	vector<ofQuaternion> pathOrientations;
     
     //convenient drawing functions
     void draweEase(CameraTrackEase ease, ofPoint screenPoint, bool easeIn);
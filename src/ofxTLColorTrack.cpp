@@ -35,6 +35,72 @@
 #include <cfloat>
 #include "ofxHotKeys.h"
 
+void ofxTLColorStore::clear(){
+	ofxTLKeyframeStore::clear();
+	samplePoints.clear();
+	colors.clear();
+}
+
+void ofxTLColorStore::reserve(int numKeys){
+	ofxTLKeyframeStore::reserve(numKeys);
+	samplePoints.reserve(numKeys);
+	colors.reserve(numKeys);
+}
+
+void ofxTLColorStore::push(ofxTLKeyframe* key){
+	ofxTLKeyframeStore::push(key);
+	ofxTLColorSample* sample = (ofxTLColorSample*)key;
+	samplePoints.push_back(sample->samplePoint);
+	colors.push_back(sample->color);
+}
+
+ofxTLColorPalette::ofxTLColorPalette()
+:	width(0),
+	height(0)
+{
+}
+
+void ofxTLColorPalette::setFromPixels(ofPixels& pixels){
+	width = pixels.getWidth();
+	height = pixels.getHeight();
+	rgba.resize(width*height*4);
+	for(int y = 0; y < height; y++){
+		for(int x = 0; x < width; x++){
+			ofColor color = pixels.getColor(x, y);
+			unsigned char* texel = &rgba[(y*width + x)*4];
+			texel[0] = color.r;
+			texel[1] = color.g;
+			texel[2] = color.b;
+			texel[3] = color.a;
+		}
+	}
+}
+
+bool ofxTLColorPalette::isAllocated(){
+	return width > 0 && height > 0;
+}
+
+ofColor ofxTLColorPalette::sample(ofVec2f position){
+	float pixelX = ofClamp(position.x * width, 0, width-1);
+	float pixelY = ofClamp(position.y * height, 0, height-1);
+	int x0 = pixelX;
+	int y0 = pixelY;
+	int x1 = MIN(x0+1, width-1);
+	int y1 = MIN(y0+1, height-1);
+	float dx = pixelX - x0, dy = pixelY - y0;
+	const unsigned char* topLeft = &rgba[(y0*width + x0)*4];
+	const unsigned char* topRight = &rgba[(y0*width + x1)*4];
+	const unsigned char* bottomLeft = &rgba[(y1*width + x0)*4];
+	const unsigned char* bottomRight = &rgba[(y1*width + x1)*4];
+	float channels[4];
+	for(int c = 0; c < 4; c++){
+		float top = topLeft[c] + (topRight[c] - topLeft[c])*dx;
+		float bottom = bottomLeft[c] + (bottomRight[c] - bottomLeft[c])*dx;
+		channels[c] = top + (bottom - top)*dy;
+	}
+	return ofColor(channels[0], channels[1], channels[2], channels[3]);
+}
+
 ofxTLColorTrack::ofxTLColorTrack()
  :	drawingColorWindow(false),
 	clickedInColorRect(false),
@@ -47,6 +113,10 @@ ofxTLColorTrack::ofxTLColorTrack()
 	//
 }
 
+ofxTLColorTrack::~ofxTLColorTrack(){
+	stopBaking();
+}
+
 void ofxTLColorTrack::draw(){
 
 	if(bounds.height == 0){
@@ -196,12 +266,14 @@ void ofxTLColorTrack::drawModalContent(){
 
 void ofxTLColorTrack::loadColorPalette(ofBaseHasPixels& image){
 	colorPallete.setFromPixels(image.getPixelsRef());
+	paletteTable.setFromPixels(colorPallete.getPixelsRef());
 	refreshAllSamples();
 }
 
 bool ofxTLColorTrack::loadColorPalette(string imagePath){
 	if(colorPallete.loadImage(imagePath)){
 		palettePath = imagePath;
+		paletteTable.setFromPixels(colorPallete.getPixelsRef());
 		refreshAllSamples();
 		return true;
 	}
@@ -223,29 +295,39 @@ ofColor ofxTLColorTrack::getColorAtPosition(float pos){
 }
 
 ofColor ofxTLColorTrack::getColorAtMillis(unsigned long long millis){
-	if(keyframes.size() == 0){
-		return defaultColor;
+	return getColorAtMillis(millis, playbackCursor);
+}
+
+ofColor ofxTLColorTrack::getColorAtMillis(unsigned long long millis, ofxTLKeyframeCursor& cursor){
+	return sampleStoreColor((ofxTLColorStore&)getKeyStore(), millis, cursor);
+}
+
+void ofxTLColorTrack::getColorsForRange(unsigned long long startMillis, unsigned long long endMillis, int count, ofColor* out){
+	ofxTLColorStore& store = (ofxTLColorStore&)getKeyStore();
+	ofxTLKeyframeCursor cursor;
+	for(int i = 0; i < count; i++){
+		out[i] = sampleStoreColor(store, rangeSampleTime(store, startMillis, endMillis, count, i), cursor);
 	}
+}
 
-	if(millis <= keyframes[0]->time){
-		//cout << "getting color before first key " << ((ofxTLColorSample*)keyframes[0])->color << endl;
-		return ((ofxTLColorSample*)keyframes[0])->color;
+ofColor ofxTLColorTrack::sampleStoreColor(ofxTLColorStore& store, unsigned long long millis, ofxTLKeyframeCursor& cursor){
+	int numKeys = store.size();
+	if(numKeys == 0){
+		return defaultColor;
 	}
 
-	if(millis >= keyframes[keyframes.size()-1]->time){
-		return ((ofxTLColorSample*)keyframes[keyframes.size()-1])->color;
+	if(millis <= store.times[0]){
+		//cout << "getting color before first key " << store.colors[0] << endl;
+		return store.colors[0];
 	}
 
-	for(int i = 1; i < keyframes.size(); i++){
-		if(keyframes[i]->time >= millis){
-			ofxTLColorSample* startSample = (ofxTLColorSample*)keyframes[i-1];
-			ofxTLColorSample* endSample = (ofxTLColorSample*)keyframes[i];
-			float interpolationPosition = ofMap(millis, startSample->time, endSample->time, 0.0, 1.0);
-			return samplePaletteAtPosition(startSample->samplePoint.getInterpolated(endSample->samplePoint, interpolationPosition));
-		}
+	if(millis >= store.times[numKeys-1]){
+		return store.colors[numKeys-1];
 	}
-	ofLogError("ofxTLColorTrack::getColorAtMillis") << "Could not find color for millis " << millis << endl;
-	return defaultColor;
+
+	int i = store.findSegmentEnd(millis, cursor);
+	float interpolationPosition = ofMap(millis, store.times[i-1], store.times[i], 0.0, 1.0);
+	return samplePaletteAtPosition(store.samplePoints[i-1].getInterpolated(store.samplePoints[i], interpolationPosition));
 }
 
 void ofxTLColorTrack::setDefaultColor(ofColor color){
@@ -273,6 +355,7 @@ bool ofxTLColorTrack::mousePressed(ofMouseEventArgs& args, long millis){
 			selectedSample->samplePoint = ofVec2f(ofMap(args.x, colorWindow.getX(), colorWindow.getMaxX(), 0, 1.0-FLT_EPSILON, true),
 												  ofMap(args.y, colorWindow.getY(), colorWindow.getMaxY(), 0, 1.0-FLT_EPSILON, true));
 			refreshSample(selectedSample);
+			keyStoreIsDirty = true;
 			shouldRecomputePreviews = true;
 		}
 		else if(args.button == 0 && previousColorRect.inside(args.x, args.y)){
@@ -280,6 +363,7 @@ bool ofxTLColorTrack::mousePressed(ofMouseEventArgs& args, long millis){
 			selectedSample->samplePoint = samplePositionAtClickTime;
 			refreshSample(selectedSample);
 			clickedInColorRect = true; //keep the window open
+			keyStoreIsDirty = true;
 			shouldRecomputePreviews = true;
 		}
 
@@ -297,12 +381,14 @@ void ofxTLColorTrack::mouseDragged(ofMouseEventArgs& args, long millis){
 			selectedSample->samplePoint = ofVec2f(ofMap(args.x, colorWindow.getX(), colorWindow.getMaxX(), 0, 1.0-FLT_EPSILON,true),
 												  ofMap(args.y, colorWindow.getY(), colorWindow.getMaxY(), 0, 1.0-FLT_EPSILON,true));
 			refreshSample(selectedSample);
+			keyStoreIsDirty = true;
 			shouldRecomputePreviews = true;
 		}
 	}
 	else{
 		ofxTLKeyframes::mouseDragged(args, millis);
 		if(keysDidDrag){
+			keyStoreIsDirty = true;
 			shouldRecomputePreviews = true;
 		}
 	}
@@ -318,6 +404,7 @@ void ofxTLColorTrack::mouseReleased(ofMouseEventArgs& args, long millis){
 			}
 			timeline->dismissedModalContent();
 			drawingColorWindow = false;
+			keyStoreIsDirty = true;
 			shouldRecomputePreviews = true;
 		}
 	}
@@ -335,6 +422,7 @@ void ofxTLColorTrack::keyPressed(ofKeyEventArgs& args){
 			}
 			timeline->dismissedModalContent();
 			drawingColorWindow = false;
+			keyStoreIsDirty = true;
 			shouldRecomputePreviews = true;
 		}
 	}
@@ -354,8 +442,12 @@ void ofxTLColorTrack::updatePreviewPalette(){
 	}
 
 	previewPalette.setUseTexture(false);
-	for(int i = 0; i < bounds.width; i++){
-		previewPalette.setColor(i, 0, getColorAtMillis(screenXToMillis(bounds.x+i)));
+	previewColors.resize(bounds.width);
+	if(previewColors.size() > 0){
+		getColorsForRange(screenXToMillis(bounds.x), screenXToMillis(bounds.x+previewColors.size()-1), previewColors.size(), &previewColors[0]);
+	}
+	for(int i = 0; i < previewColors.size(); i++){
+		previewPalette.setColor(i, 0, previewColors[i]);
 	}
 	previewPalette.setUseTexture(true);
 	previewPalette.update();
@@ -364,7 +456,7 @@ void ofxTLColorTrack::updatePreviewPalette(){
 }
 
 ofxTLKeyframe* ofxTLColorTrack::newKeyframe(){
-	ofxTLColorSample* sample = new ofxTLColorSample();
+	ofxTLColorSample* sample = allocateKeyframe<ofxTLColorSample>();
 	sample->samplePoint = ofVec2f(.5,.5);
 	sample->color = defaultColor;
 	//when creating a new keyframe select it and draw a color window
@@ -378,6 +470,10 @@ ofxTLKeyframe* ofxTLColorTrack::newKeyframe(){
 	return sample;
 }
 
+ofxTLKeyframeStore* ofxTLColorTrack::newKeyframeStore(){
+	return new ofxTLColorStore();
+}
+
 void ofxTLColorTrack::restoreKeyframe(ofxTLKeyframe* key, ofxXmlSettings& xmlStore){
 	ofxTLColorSample* sample = (ofxTLColorSample*)key;
 
@@ -397,10 +493,10 @@ void ofxTLColorTrack::storeKeyframe(ofxTLKeyframe* key, ofxXmlSettings& xmlStore
 }
 
 void ofxTLColorTrack::regionSelected(ofLongRange timeRange, ofRange valueRange){
-    for(int i = 0; i < keyframes.size(); i++){
-    	if(timeRange.contains( keyframes[i]->time )){
-            selectKeyframe(keyframes[i]);
-        }
+	int startIndex, endIndex;
+	getKeyIndicesInRange(timeRange, startIndex, endIndex);
+    for(int i = startIndex; i < endIndex; i++){
+		selectKeyframe(keyframes[i]);
 	}
 }
 
@@ -435,7 +531,9 @@ void ofxTLColorTrack::setNextAndPreviousSamples(){
 
 ofxTLKeyframe* ofxTLColorTrack::keyframeAtScreenpoint(ofVec2f p){
 	if(isHovering()){
-		for(int i = 0; i < keyframes.size(); i++){
+		int startIndex, endIndex;
+		getKeyIndicesNearScreenX(p.x, 5, startIndex, endIndex);
+		for(int i = startIndex; i < endIndex; i++){
 			float offset = p.x - timeline->millisToScreenX(keyframes[i]->time);
 			if (abs(offset) < 5) {
 				return keyframes[i];
@@ -449,6 +547,7 @@ void ofxTLColorTrack::refreshAllSamples(){
 	for(int i = 0; i < keyframes.size(); i++){
 		refreshSample((ofxTLColorSample*)keyframes[i]);
 	}
+	keyStoreIsDirty = true;
 	shouldRecomputePreviews = true;
 }
 
@@ -458,16 +557,8 @@ void ofxTLColorTrack::refreshSample(ofxTLColorSample* sample){
 
 //assumes normalized position
 ofColor ofxTLColorTrack::samplePaletteAtPosition(ofVec2f position){
-	if(colorPallete.bAllocated()){
-		ofVec2f positionPixelSpace = position * ofVec2f(colorPallete.getWidth(),colorPallete.getHeight());
-		//bilinear interpolation from http://www.gamedev.net/page/resources/_/technical/graphics-programming-and-theory/bilinear-interpolation-of-texture-maps-r810
-		int x0 = int(positionPixelSpace.x);
-		int y0 = int(positionPixelSpace.y);
-		float dx = positionPixelSpace.x-x0, dy = positionPixelSpace.y-y0, omdx = 1-dx, omdy = 1-dy;
-		return colorPallete.getPixelsRef().getColor(x0,y0)*omdx*omdy +
-	           colorPallete.getPixelsRef().getColor(x0,MIN(y0+1, colorPallete.getHeight()-1))*omdx*dy +
-               colorPallete.getPixelsRef().getColor(MIN(x0+1,colorPallete.getWidth()-1),y0)*dx*omdy +
-			   colorPallete.getPixelsRef().getColor(MIN(x0+1,colorPallete.getWidth()-1),MIN(y0+1, colorPallete.getHeight()-1))*dx*dy;
+	if(paletteTable.isAllocated()){
+		return paletteTable.sample(position);
 	}
 	else{
 		ofLogError("ofxTLColorTrack::refreshSample -- sampling palette is null");
@@ -41,9 +41,36 @@ class ofxTLColorSample : public ofxTLKeyframe {
 	ofColor color; //cached sample
 };
 
+//each key's palette position and cached color packed beside the times of the store
+class ofxTLColorStore : public ofxTLKeyframeStore {
+  public:
+	virtual void clear();
+	virtual void reserve(int numKeys);
+	virtual void push(ofxTLKeyframe* key);
+
+	vector<ofVec2f> samplePoints;
+	vector<ofColor> colors;
+};
+
+//the palette image copied into a packed rgba table when it's loaded,
+//so sampling doesn't go through ofPixels for every color
+class ofxTLColorPalette {
+  public:
+	ofxTLColorPalette();
+	void setFromPixels(ofPixels& pixels);
+	bool isAllocated();
+	//bilinear sample at a position normalized to the palette
+	ofColor sample(ofVec2f position);
+
+	int width;
+	int height;
+	vector<unsigned char> rgba;
+};
+
 class ofxTLColorTrack : public ofxTLKeyframes {
   public:
     ofxTLColorTrack();
+	virtual ~ofxTLColorTrack();
 	
 	virtual void draw();
     virtual void drawModalContent();
@@ -64,7 +91,12 @@ class ofxTLColorTrack : public ofxTLKeyframes {
     ofColor getColor();
 	ofColor getColorAtSecond(float second);
 	ofColor getColorAtMillis(unsigned long long millis);
+	//samples with your own cursor, use this when reading the track from more than one place
+	ofColor getColorAtMillis(unsigned long long millis, ofxTLKeyframeCursor& cursor);
 	ofColor getColorAtPosition(float pos);
+	//fills out with count colors evenly spaced from startMillis to endMillis, both inclusive.
+	//much faster than calling getColorAtMillis in a loop, for filling lots of LEDs or pixels each frame
+	void getColorsForRange(unsigned long long startMillis, unsigned long long endMillis, int count, ofColor* out);
 
 	virtual void setDefaultColor(ofColor color);
 	virtual ofColor getDefaultColor();
@@ -72,11 +104,15 @@ class ofxTLColorTrack : public ofxTLKeyframes {
 	
   protected:
 	ofImage colorPallete;
+	//what colors are sampled from, refreshed whenever colorPallete is loaded
+	ofxTLColorPalette paletteTable;
 	ofImage previewPalette;
+	vector<ofColor> previewColors;
 	string palettePath;
 	
 	virtual void updatePreviewPalette();
 	virtual ofxTLKeyframe* newKeyframe();
+	virtual ofxTLKeyframeStore* newKeyframeStore();
     virtual ofxTLKeyframe* keyframeAtScreenpoint(ofVec2f p);
 	
 	ofColor colorAtClickTime;
@@ -99,6 +135,7 @@ class ofxTLColorTrack : public ofxTLKeyframes {
 	ofxTLColorSample* nextSample;
 	void refreshSample(ofxTLColorSample* sample);
 	ofColor samplePaletteAtPosition(ofVec2f position);
+	ofColor sampleStoreColor(ofxTLColorStore& store, unsigned long long millis, ofxTLKeyframeCursor& cursor);
 	
 	ofColor defaultColor;
 	
@@ -34,12 +34,41 @@
 #include "ofxTimeline.h"
 #include "ofxHotKeys.h"
 
+void ofxTLCurvesStore::clear(){
+	ofxTLKeyframeStore::clear();
+	easings.clear();
+	easeTypes.clear();
+	kernels.clear();
+	easeFunctions.clear();
+}
+
+void ofxTLCurvesStore::reserve(int numKeys){
+	ofxTLKeyframeStore::reserve(numKeys);
+	easings.reserve(numKeys);
+	easeTypes.reserve(numKeys);
+	kernels.reserve(numKeys);
+	easeFunctions.reserve(numKeys);
+}
+
+void ofxTLCurvesStore::push(ofxTLKeyframe* key){
+	ofxTLKeyframeStore::push(key);
+	ofxTLTweenKeyframe* tweenKey = (ofxTLTweenKeyframe*)key;
+	easings.push_back(tweenKey->easeFunc->easing);
+	easeTypes.push_back(tweenKey->easeType->type);
+	kernels.push_back(ofxTLInterpolationKernels::kernelForEasing(tweenKey->easeFunc->easing, tweenKey->easeType->type));
+	easeFunctions.push_back(ofxTLInterpolationKernels::functionForEasing(tweenKey->easeFunc->easing, tweenKey->easeType->type));
+}
+
 ofxTLCurves::ofxTLCurves(){
 	initializeEasings();
 	valueRange = ofRange(0.0, 1.0);
 	drawingEasingWindow = false;
 }
 
+ofxTLCurves::~ofxTLCurves(){
+	stopBaking();
+}
+
 float ofxTLCurves::interpolateValueForKeys(ofxTLKeyframe* start,ofxTLKeyframe* end, unsigned long long sampleTime){
 	ofxTLTweenKeyframe* tweenKeyStart = (ofxTLTweenKeyframe*)start;
 	ofxTLTweenKeyframe* tweenKeyEnd = (ofxTLTweenKeyframe*)end;
@@ -48,12 +77,82 @@ float ofxTLCurves::interpolateValueForKeys(ofxTLKeyframe* start,ofxTLKeyframe* e
 						 false, *tweenKeyStart->easeFunc->easing, tweenKeyStart->easeType->type);
 }
 
+float ofxTLCurves::interpolateValueForStoredKeys(ofxTLKeyframeStore& store, int startIndex, int endIndex, unsigned long long sampleTime){
+	ofxTLCurvesStore& curvesStore = (ofxTLCurvesStore&)store;
+	return easeSegment(curvesStore, startIndex, endIndex, sampleTime);
+}
+
+float ofxTLCurves::easeSegment(ofxTLCurvesStore& store, int startIndex, int endIndex, unsigned long long sampleTime){
+	ofxTLEasingFunction ease = store.easeFunctions[startIndex];
+	if(ease == NULL){
+		return ofxTween::map(sampleTime, store.times[startIndex], store.times[endIndex],
+										 store.values[startIndex], store.values[endIndex],
+							 false, *store.easings[startIndex], store.easeTypes[startIndex]);
+	}
+	return ease(sampleTime - store.times[startIndex],
+				store.values[startIndex],
+				store.values[endIndex] - store.values[startIndex],
+				store.times[endIndex] - store.times[startIndex]);
+}
+
+float ofxTLCurves::evaluateStoredKeyAtTime(ofxTLKeyframeStore& store, int index, unsigned long long sampleTime, bool firstKey){
+	return store.values[index];
+}
+
+ofxTLKeyframeStore* ofxTLCurves::newKeyframeStore(){
+	return new ofxTLCurvesStore();
+}
+
+void ofxTLCurves::sampleStoreRange(ofxTLKeyframeStore& keyframeStore, unsigned long long startMillis, unsigned long long endMillis, int count, float* out){
+	ofxTLCurvesStore& store = (ofxTLCurvesStore&)keyframeStore;
+	int numKeys = store.size();
+	if(numKeys == 0){
+		ofxTLKeyframes::sampleStoreRange(keyframeStore, startMillis, endMillis, count, out);
+		return;
+	}
+	
+	ofxTLKeyframeCursor cursor;
+	int i = 0;
+	while(i < count){
+		unsigned long long sampleTime = rangeSampleTime(store, startMillis, endMillis, count, i);
+		if(sampleTime <= store.times[0]){
+			out[i++] = ofMap(store.values[0], 0.0, 1.0, store.valueRange.min, store.valueRange.max, false);
+			continue;
+		}
+		if(sampleTime >= store.times[numKeys-1]){
+			out[i++] = ofMap(store.values[numKeys-1], 0.0, 1.0, store.valueRange.min, store.valueRange.max, false);
+			continue;
+		}
+		
+		int k = store.findSegmentEnd(sampleTime, cursor);
+		if(store.kernels[k-1] == OFXTL_KERNEL_NONE){
+			out[i++] = ofMap(easeSegment(store, k-1, k, sampleTime), 0.0, 1.0, store.valueRange.min, store.valueRange.max, false);
+			continue;
+		}
+		
+		//collect the run of samples inside this segment as elapsed time into the output buffer,
+		//then ease the whole run in place
+		int runStart = i;
+		while(i < count){
+			sampleTime = rangeSampleTime(store, startMillis, endMillis, count, i);
+			if(sampleTime <= store.times[k-1] || sampleTime > store.times[k]){
+				break;
+			}
+			out[i++] = sampleTime - store.times[k-1];
+		}
+		ofxTLInterpolationKernels::interpolate(store.kernels[k-1], out + runStart, store.times[k] - store.times[k-1],
+											   ofMap(store.values[k-1], 0.0, 1.0, store.valueRange.min, store.valueRange.max, false),
+											   ofMap(store.values[k], 0.0, 1.0, store.valueRange.min, store.valueRange.max, false),
+											   i - runStart, out + runStart);
+	}
+}
+
 string ofxTLCurves::getTrackType(){
 	return "Curves";    
 }
 
 ofxTLKeyframe* ofxTLCurves::newKeyframe(){
-	ofxTLTweenKeyframe* k = new ofxTLTweenKeyframe();
+	ofxTLTweenKeyframe* k = allocateKeyframe<ofxTLTweenKeyframe>();
 	k->easeFunc = easingFunctions[0];
 	k->easeType = easingTypes[0];
 	return k;
@@ -160,6 +259,7 @@ void ofxTLCurves::mouseReleased(ofMouseEventArgs& args, long millis){
 					((ofxTLTweenKeyframe*)selectedKeyframes[k])->easeFunc = easingFunctions[i];
 				}
 				timeline->flagTrackModified(this);
+				keyStoreIsDirty = true;
 				shouldRecomputePreviews = true;
 				return;
 			}
@@ -171,6 +271,7 @@ void ofxTLCurves::mouseReleased(ofMouseEventArgs& args, long millis){
 					((ofxTLTweenKeyframe*)selectedKeyframes[k])->easeType = easingTypes[i];
 				}
 				timeline->flagTrackModified(this);
+				keyStoreIsDirty = true;
 				shouldRecomputePreviews = true;
 				return;
 			}
@@ -207,7 +308,13 @@ void ofxTLCurves::storeKeyframe(ofxTLKeyframe* key, ofxXmlSettings& xmlStore){
     xmlStore.addValue("easetype", tweenKey->easeType->id);
 }
 
-void ofxTLCurves::initializeEasings(){
+const ofxTLEasingRegistry& ofxTLEasingRegistry::get(){
+	//built by the first curves track, shared by all the others
+	static ofxTLEasingRegistry registry;
+	return registry;
+}
+
+ofxTLEasingRegistry::ofxTLEasingRegistry(){
     
 	//FUNCTIONS ----
 	EasingFunction* ef;
@@ -318,3 +425,13 @@ void ofxTLCurves::initializeEasings(){
 	
 }
 
+void ofxTLCurves::initializeEasings(){
+	const ofxTLEasingRegistry& registry = ofxTLEasingRegistry::get();
+	easingFunctions = registry.easingFunctions;
+	easingTypes = registry.easingTypes;
+	tweenBoxWidth = registry.tweenBoxWidth;
+	tweenBoxHeight = registry.tweenBoxHeight;
+	easingBoxWidth = registry.easingBoxWidth;
+	easingBoxHeight = registry.easingBoxHeight;
+}
+
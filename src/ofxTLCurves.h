@@ -36,6 +36,7 @@
 #include "ofMain.h"
 #include "ofxTLKeyframes.h"
 #include "ofxTween.h"
+#include "ofxTLInterpolationKernels.h"
 
 typedef struct {
 	int id;
@@ -55,15 +56,49 @@ typedef struct {
 	ofxTween::ofxEasingType type;
 } EasingType;
 
+//the easing functions and types curves tracks offer, with their menu layout and preview lines.
+//built once the first time a curves track is created and shared by every track after that,
+//nothing changes it afterwards
+class ofxTLEasingRegistry {
+  public:
+	static const ofxTLEasingRegistry& get();
+
+	vector<EasingFunction*> easingFunctions;
+	vector<EasingType*> easingTypes;
+	
+	float easingBoxWidth;
+	float easingBoxHeight;
+	float tweenBoxWidth;
+	float tweenBoxHeight;
+
+  private:
+	ofxTLEasingRegistry();
+};
+
 class ofxTLTweenKeyframe : public ofxTLKeyframe{
   public:
     EasingFunction* easeFunc;
 	EasingType* easeType;
 };
 
+//each key's easing packed beside the times and values of the store
+class ofxTLCurvesStore : public ofxTLKeyframeStore {
+  public:
+	virtual void clear();
+	virtual void reserve(int numKeys);
+	virtual void push(ofxTLKeyframe* key);
+
+	vector<ofxEasing*> easings;
+	vector<ofxTween::ofxEasingType> easeTypes;
+	vector<ofxTLEasingKernel> kernels;
+	//resolved once when the store is built, NULL for easings that need ofxTween::map
+	vector<ofxTLEasingFunction> easeFunctions;
+};
+
 class ofxTLCurves : public ofxTLKeyframes {
   public:
     ofxTLCurves();
+	virtual ~ofxTLCurves();
 
 //    virtual void draw();
     virtual void drawModalContent();
@@ -78,14 +113,24 @@ class ofxTLCurves : public ofxTLKeyframes {
     
   protected:
 	
+	//samples the easings straight from the packed key store
+	virtual void sampleStoreRange(ofxTLKeyframeStore& store, unsigned long long startMillis, unsigned long long endMillis, int count, float* out);
+	
     virtual ofxTLKeyframe* newKeyframe();
     virtual void restoreKeyframe(ofxTLKeyframe* key, ofxXmlSettings& xmlStore);
 	virtual void storeKeyframe(ofxTLKeyframe* key, ofxXmlSettings& xmlStore);
     
     virtual void selectedKeySecondaryClick(ofMouseEventArgs& args);	
 	virtual float interpolateValueForKeys(ofxTLKeyframe* start,ofxTLKeyframe* end, unsigned long long sampleTime);
+	virtual float interpolateValueForStoredKeys(ofxTLKeyframeStore& store, int startIndex, int endIndex, unsigned long long sampleTime);
+	virtual float evaluateStoredKeyAtTime(ofxTLKeyframeStore& store, int index, unsigned long long sampleTime, bool firstKey = false);
+	virtual ofxTLKeyframeStore* newKeyframeStore();
+	//eases between two keys of the store through the function resolved for the segment
+	float easeSegment(ofxTLCurvesStore& store, int startIndex, int endIndex, unsigned long long sampleTime);
+
 	
 	//easing dialog stuff
+	//points these at the shared ofxTLEasingRegistry, don't modify what they point to
     void initializeEasings();
 	ofVec2f easingWindowPosition;
 	bool drawingEasingWindow;
@@ -143,7 +143,7 @@ string ofxTLEmptyKeyframes::getTrackType(){
 
 ofxTLKeyframe* ofxTLEmptyKeyframes::newKeyframe(){
 	//return our type of keyframe, stored in the parent class
-	ofxTLEmptyKeyframe* newKey = new ofxTLEmptyKeyframe();
+	ofxTLEmptyKeyframe* newKey = allocateKeyframe<ofxTLEmptyKeyframe>();
 	newKey->color = ofColor(ofRandom(255),ofRandom(255),ofRandom(255));
 	return newKey;
 }
@@ -80,6 +80,78 @@ class ofxTLBangEventArgs : public ofEventArgs {
 	string flag;
 };
 
+//a bang worked out ahead of time by the timeline's bang scheduler.
+//appSeconds is the time it's due on the timeline's ofxMSATimer (timeline->getTimer())
+class ofxTLScheduledBang {
+  public:
+	ofxTLTrack* track;
+	long millis;
+	double appSeconds;
+	int generation;
+	char flag[128]; //fixed so that popping never allocates, longer flags are truncated
+};
+
+//lock free ring of scheduled bangs for exactly one producer thread and one consumer thread.
+//the timeline pushes from wherever it updates, the main thread or an audio callback drains it
+class ofxTLBangQueue {
+  public:
+	ofxTLBangQueue(int capacity = 4096){
+		int size = 1;
+		while(size < capacity){
+			size <<= 1;
+		}
+		slots.resize(size);
+		mask = size-1;
+		writeIndex = 0;
+		readIndex = 0;
+	}
+	
+	//producer
+	bool push(const ofxTLScheduledBang& bang){
+		unsigned int write = writeIndex;
+		if(write - readIndex > mask){
+			return false;
+		}
+		slots[write & mask] = bang;
+		barrier();
+		writeIndex = write+1;
+		return true;
+	}
+	
+	//consumer, the front slot stays valid until pop()
+	const ofxTLScheduledBang* front(){
+		unsigned int read = readIndex;
+		if(read == writeIndex){
+			return NULL;
+		}
+		barrier();
+		return &slots[read & mask];
+	}
+	
+	void pop(){
+		barrier();
+		readIndex = readIndex+1;
+	}
+	
+	bool empty(){
+		return readIndex == writeIndex;
+	}
+	
+  protected:
+	static inline void barrier(){
+		#ifdef _MSC_VER
+		MemoryBarrier();
+		#else
+		__sync_synchronize();
+		#endif
+	}
+	
+	vector<ofxTLScheduledBang> slots;
+	unsigned int mask;
+	volatile unsigned int writeIndex;
+	volatile unsigned int readIndex;
+};
+
 class ofxTLSwitchEventArgs : public ofEventArgs {
   public:
     ofxTimeline* sender;
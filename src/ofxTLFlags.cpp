@@ -103,6 +103,7 @@ bool ofxTLFlags::mousePressed(ofMouseEventArgs& args, long millis){
         }
 		if(ofGetModifierSelection() && clickedTextField->textField.getIsEditing()){
 			clickedTextField->textField.endEditing();
+			indexFlag(clickedTextField);
 		}
 		else{
 			clickedTextField->textField.beginEditing();
@@ -117,6 +118,7 @@ bool ofxTLFlags::mousePressed(ofMouseEventArgs& args, long millis){
 			for(int i = 0; i < selectedKeyframes.size(); i++){
 				((ofxTLFlag*)selectedKeyframes[i])->textField.endEditing();
 			}
+			indexSelectedFlags();
 			enteringText = false;
 			timeline->dismissedModalContent();
 		}
@@ -156,6 +158,7 @@ void ofxTLFlags::mouseReleased(ofMouseEventArgs& args, long millis){
 		}
 
 		if(!enteringText){
+			indexSelectedFlags();
 			timeline->dismissedModalContent();
 			timeline->flagTrackModified(this);
 		}
@@ -171,6 +174,7 @@ void ofxTLFlags::keyPressed(ofKeyEventArgs& args){
         //enter key submits the values
         //This could be done be responding to the event from the text field itself...
         if(args.key == OF_KEY_RETURN){
+            indexSelectedFlags();
             enteringText = false;
             timeline->dismissedModalContent();
             timeline->flagTrackModified(this);
@@ -183,12 +187,13 @@ void ofxTLFlags::keyPressed(ofKeyEventArgs& args){
 }
 
 ofxTLKeyframe* ofxTLFlags::newKeyframe(){
-	ofxTLFlag* key = new ofxTLFlag();
+	ofxTLFlag* key = allocateKeyframe<ofxTLFlag>();
 	key->textField.setFont(timeline->getFont());
 	return key;
 }
 
 void ofxTLFlags::unselectAll(){
+	indexSelectedFlags();
 	for(int i = 0; i < selectedKeyframes.size(); i++){
         ((ofxTLFlag*)selectedKeyframes[i])->textField.disable();
     }
@@ -198,6 +203,7 @@ void ofxTLFlags::unselectAll(){
 void ofxTLFlags::restoreKeyframe(ofxTLKeyframe* key, ofxXmlSettings& xmlStore){
     ofxTLFlag* triggerKey = (ofxTLFlag*)key;
     triggerKey->textField.text = xmlStore.getValue("flag", "");
+	indexFlag(triggerKey);
 }
 
 void ofxTLFlags::storeKeyframe(ofxTLKeyframe* key, ofxXmlSettings& xmlStore){
@@ -212,6 +218,7 @@ void ofxTLFlags::willDeleteKeyframe(ofxTLKeyframe* keyframe){
 		timeline->flagTrackModified(this);
 	}
 	flag->textField.disable();
+	unindexFlag(flag);
 }
 
 void ofxTLFlags::bangFired(ofxTLKeyframe* key){
@@ -228,6 +235,10 @@ void ofxTLFlags::bangFired(ofxTLKeyframe* key){
     ofNotifyEvent(events().bangFired, args);    
 }
 
+void ofxTLFlags::bangScheduled(ofxTLKeyframe* key, long millis, double appSeconds){
+	timeline->scheduleBang(this, millis, appSeconds, ((ofxTLFlag*)key)->textField.text);
+}
+
 string ofxTLFlags::getTrackType(){
     return "Flags";
 }
@@ -241,18 +252,78 @@ void ofxTLFlags::addFlagAtTime(string key, unsigned long long time){
 	ofxTLFlag* flag = (ofxTLFlag*)keyFrame;
 	setKeyframeTime(keyFrame, time);
 	flag->textField.text = key;
+	indexFlag(flag);
 	keyframes.push_back(keyFrame);
 	updateKeyframeSort();
 	timeline->flagTrackModified(this);
 }
 
 ofxTLFlag* ofxTLFlags::getFlagWithKey(string key){
-	for(int i = 0; i < keyframes.size(); i++){
-		ofxTLFlag* flag = (ofxTLFlag*)keyframes[i];
-		if( flag->textField.text == key ){
-			return flag;
+	map<string, vector<ofxTLFlag*> >::iterator it = flagIndex.find(key);
+	if(it == flagIndex.end()){
+		return NULL;
+	}
+	//flags are filed in the order they were named, not by time
+	vector<ofxTLFlag*>& flags = it->second;
+	ofxTLFlag* earliest = flags[0];
+	for(int i = 1; i < flags.size(); i++){
+		if(flags[i]->time < earliest->time){
+			earliest = flags[i];
+		}
+	}
+	return earliest;
+}
+
+bool ofxTLFlags::seekToFlag(string key){
+	ofxTLFlag* flag = getFlagWithKey(key);
+	if(flag == NULL){
+		ofLogWarning("ofxTLFlags::seekToFlag") << "no flag named " << key << " on track " << getName();
+		return false;
+	}
+	timeline->setCurrentTimeMillis(flag->time);
+	return true;
+}
+
+vector<ofxTLFlag*> ofxTLFlags::getFlagsInRange(unsigned long long startMillis, unsigned long long endMillis){
+	vector<ofxTLFlag*> flags;
+	ofxTLKeyframeStore& store = getKeyStore();
+	int i = lower_bound(store.times.begin(), store.times.end(), startMillis) - store.times.begin();
+	for(; i < store.size() && store.times[i] <= endMillis; i++){
+		flags.push_back((ofxTLFlag*)store.keys[i]);
+	}
+	return flags;
+}
+
+void ofxTLFlags::indexFlag(ofxTLFlag* flag){
+	if(flag->textField.text == flag->indexedText){
+		return;
+	}
+	unindexFlag(flag);
+	//unnamed flags can't be looked up, leave them out
+	if(flag->textField.text != ""){
+		flagIndex[flag->textField.text].push_back(flag);
+	}
+	flag->indexedText = flag->textField.text;
+}
+
+void ofxTLFlags::unindexFlag(ofxTLFlag* flag){
+	if(flag->indexedText == ""){
+		return;
+	}
+	map<string, vector<ofxTLFlag*> >::iterator it = flagIndex.find(flag->indexedText);
+	if(it != flagIndex.end()){
+		vector<ofxTLFlag*>& flags = it->second;
+		flags.erase(remove(flags.begin(), flags.end(), flag), flags.end());
+		if(flags.empty()){
+			flagIndex.erase(it);
 		}
 	}
-	return NULL;
+	flag->indexedText = "";
+}
+
+void ofxTLFlags::indexSelectedFlags(){
+	for(int i = 0; i < selectedKeyframes.size(); i++){
+		indexFlag((ofxTLFlag*)selectedKeyframes[i]);
+	}
 }
 
@@ -39,6 +39,7 @@ class ofxTLFlag : public ofxTLKeyframe {
   public:
     ofxTextInputField textField;
     ofRectangle display;
+	string indexedText; //the name it's filed under in the track's flag index
 //	virtual ~ofxTLFlag();
 };
 
@@ -59,7 +60,9 @@ class ofxTLFlags : public ofxTLBangs {
 	
 	virtual void addFlag(string key);
 	virtual void addFlagAtTime(string key, unsigned long long time);
-    virtual ofxTLFlag* getFlagWithKey(string key);
+    virtual ofxTLFlag* getFlagWithKey(string key); //the earliest flag with this text
+	virtual bool seekToFlag(string key); //moves the playhead to getFlagWithKey(key)
+	virtual vector<ofxTLFlag*> getFlagsInRange(unsigned long long startMillis, unsigned long long endMillis);
 	
 protected:
     
@@ -67,10 +70,17 @@ protected:
     virtual void restoreKeyframe(ofxTLKeyframe* key, ofxXmlSettings& xmlStore);
 	virtual void storeKeyframe(ofxTLKeyframe* key, ofxXmlSettings& xmlStore);
     virtual void bangFired(ofxTLKeyframe* key);
+	virtual void bangScheduled(ofxTLKeyframe* key, long millis, double appSeconds);
 	virtual void willDeleteKeyframe(ofxTLKeyframe* keyframe);
 
 	//only set per mousedown/mouseup cycle
 	ofxTLFlag* clickedTextField;
 	bool enteringText;
 
+	//flag text to every flag with it, refiled whenever an edit is committed
+	map<string, vector<ofxTLFlag*> > flagIndex;
+	void indexFlag(ofxTLFlag* flag);
+	void unindexFlag(ofxTLFlag* flag);
+	void indexSelectedFlags();
+
 };
\ No newline at end of file
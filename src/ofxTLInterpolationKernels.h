@@ -0,0 +1,295 @@
+/**
+ * ofxTimeline
+ * openFrameworks graphical timeline addon
+ *
+ * Copyright (c) 2011-2012 James George
+ * Development Supported by YCAM InterLab http://interlab.ycam.jp/en/
+ * http://jamesgeorge.org + http://flightphase.com
+ * http://github.com/obviousjim + http://github.com/flightphase
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include "ofMain.h"
+#include "ofxTween.h"
+#include <typeinfo>
+
+//SSE2 is always there on x86_64 and NEON on the arm builds that enable it,
+//anything else uses the scalar versions
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OFXTL_KERNELS_SSE
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define OFXTL_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+//easings that can be evaluated several samples at a time.
+//the rest, and quadratic in-out whose ofxTween version depends on
+//the compiler's evaluation order, go through ofxTween::map one sample at a time
+typedef enum {
+	OFXTL_KERNEL_NONE = 0,
+	OFXTL_KERNEL_LINEAR,
+	OFXTL_KERNEL_QUAD_IN,
+	OFXTL_KERNEL_QUAD_OUT,
+	OFXTL_KERNEL_CUBIC_IN,
+	OFXTL_KERNEL_CUBIC_OUT,
+	OFXTL_KERNEL_CUBIC_IN_OUT
+} ofxTLEasingKernel;
+
+//an easing and type resolved to a plain function taking ofxEasing's
+//elapsed time, start value, change in value and duration
+typedef float (*ofxTLEasingFunction)(float t, float b, float c, float d);
+
+//the instance ofxTLEase calls through, one per easing class.
+//a static member is constructed before main, unlike a function local static whose first use
+//isn't guarded on older compilers like MSVC2010 and could race between sampling threads
+template<typename EasingClass>
+class ofxTLEasingInstance {
+  public:
+	static EasingClass easing;
+};
+
+template<typename EasingClass>
+EasingClass ofxTLEasingInstance<EasingClass>::easing;
+
+//one instantiation per easing class and type. the qualified call skips the virtual dispatch
+//and the type switch that ofxTween::map goes through on every sample
+template<typename EasingClass, ofxTween::ofxEasingType Type>
+float ofxTLEase(float t, float b, float c, float d){
+	EasingClass& easing = ofxTLEasingInstance<EasingClass>::easing;
+	if(Type == ofxTween::easeIn){
+		return easing.EasingClass::easeIn(t, b, c, d);
+	}
+	if(Type == ofxTween::easeOut){
+		return easing.EasingClass::easeOut(t, b, c, d);
+	}
+	return easing.EasingClass::easeInOut(t, b, c, d);
+}
+
+class ofxTLInterpolationKernels {
+  public:
+
+	//finds the specialized function for one of the easings ofxTLCurves offers,
+	//or NULL for any other easing class, which has to go through ofxTween::map.
+	//classes are matched exactly, so a subclass of a stock easing keeps its own easeIn/Out
+	static ofxTLEasingFunction functionForEasing(ofxEasing* easing, ofxTween::ofxEasingType type){
+		const type_info& easingClass = typeid(*easing);
+		if(easingClass == typeid(ofxEasingLinear))	return functionForType<ofxEasingLinear>(type);
+		if(easingClass == typeid(ofxEasingSine))	return functionForType<ofxEasingSine>(type);
+		if(easingClass == typeid(ofxEasingCirc))	return functionForType<ofxEasingCirc>(type);
+		if(easingClass == typeid(ofxEasingQuad))	return functionForType<ofxEasingQuad>(type);
+		if(easingClass == typeid(ofxEasingCubic))	return functionForType<ofxEasingCubic>(type);
+		if(easingClass == typeid(ofxEasingQuart))	return functionForType<ofxEasingQuart>(type);
+		if(easingClass == typeid(ofxEasingQuint))	return functionForType<ofxEasingQuint>(type);
+		if(easingClass == typeid(ofxEasingExpo))	return functionForType<ofxEasingExpo>(type);
+		if(easingClass == typeid(ofxEasingBack))	return functionForType<ofxEasingBack>(type);
+		if(easingClass == typeid(ofxEasingBounce))	return functionForType<ofxEasingBounce>(type);
+		if(easingClass == typeid(ofxEasingElastic))	return functionForType<ofxEasingElastic>(type);
+		return NULL;
+	}
+
+	template<typename EasingClass>
+	static ofxTLEasingFunction functionForType(ofxTween::ofxEasingType type){
+		switch(type){
+			case ofxTween::easeIn:
+				return &ofxTLEase<EasingClass, ofxTween::easeIn>;
+			case ofxTween::easeOut:
+				return &ofxTLEase<EasingClass, ofxTween::easeOut>;
+			default:
+				return &ofxTLEase<EasingClass, ofxTween::easeInOut>;
+		}
+	}
+
+	//finds the kernel matching an easing, or OFXTL_KERNEL_NONE if there isn't one.
+	//matches classes exactly like functionForEasing
+	static ofxTLEasingKernel kernelForEasing(ofxEasing* easing, ofxTween::ofxEasingType type){
+		const type_info& easingClass = typeid(*easing);
+		if(easingClass == typeid(ofxEasingLinear)){
+			return OFXTL_KERNEL_LINEAR;
+		}
+		if(easingClass == typeid(ofxEasingQuad)){
+			if(type == ofxTween::easeIn) return OFXTL_KERNEL_QUAD_IN;
+			if(type == ofxTween::easeOut) return OFXTL_KERNEL_QUAD_OUT;
+		}
+		if(easingClass == typeid(ofxEasingCubic)){
+			if(type == ofxTween::easeIn) return OFXTL_KERNEL_CUBIC_IN;
+			if(type == ofxTween::easeOut) return OFXTL_KERNEL_CUBIC_OUT;
+			if(type == ofxTween::easeInOut) return OFXTL_KERNEL_CUBIC_IN_OUT;
+		}
+		return OFXTL_KERNEL_NONE;
+	}
+
+	//computes out[i] = from + (to - from) * ease(elapsed[i] / duration) for count samples,
+	//the same as ofxTween::map(elapsed[i], 0, duration, from, to, false, easing, type).
+	//elapsed and out may be the same buffer
+	static void interpolate(ofxTLEasingKernel kernel, const float* elapsed, float duration,
+							float from, float to, int count, float* out){
+		if(useVectorized()){
+			interpolateVectorized(kernel, elapsed, duration, from, to, count, out);
+		}
+		else{
+			interpolateScalar(kernel, elapsed, duration, from, to, count, out);
+		}
+	}
+
+	//reference implementation, one sample at a time
+	static void interpolateScalar(ofxTLEasingKernel kernel, const float* elapsed, float duration,
+								  float from, float to, int count, float* out){
+		float invDuration = 1.0f / duration;
+		float range = to - from;
+		for(int i = 0; i < count; i++){
+			float x = elapsed[i] * invDuration;
+			float y = x - 1.0f;
+			float s;
+			switch(kernel){
+				case OFXTL_KERNEL_QUAD_IN:
+					s = x * x;
+					break;
+				case OFXTL_KERNEL_QUAD_OUT:
+					s = x * (2.0f - x);
+					break;
+				case OFXTL_KERNEL_CUBIC_IN:
+					s = x * x * x;
+					break;
+				case OFXTL_KERNEL_CUBIC_OUT:
+					s = y * y * y + 1.0f;
+					break;
+				case OFXTL_KERNEL_CUBIC_IN_OUT:
+					s = x < 0.5f ? 4.0f * x * x * x : 4.0f * y * y * y + 1.0f;
+					break;
+				default:
+					s = x;
+					break;
+			}
+			out[i] = from + range * s;
+		}
+	}
+
+	//four samples at a time where the platform allows, the remainder goes through the scalar version
+	static void interpolateVectorized(ofxTLEasingKernel kernel, const float* elapsed, float duration,
+									  float from, float to, int count, float* out){
+		int i = 0;
+#if defined(OFXTL_KERNELS_SSE)
+		__m128 invDuration = _mm_set1_ps(1.0f / duration);
+		__m128 start = _mm_set1_ps(from);
+		__m128 range = _mm_set1_ps(to - from);
+		__m128 one = _mm_set1_ps(1.0f);
+		__m128 two = _mm_set1_ps(2.0f);
+		__m128 four = _mm_set1_ps(4.0f);
+		__m128 half = _mm_set1_ps(0.5f);
+		for(; i + 4 <= count; i += 4){
+			__m128 x = _mm_mul_ps(_mm_loadu_ps(elapsed + i), invDuration);
+			__m128 y = _mm_sub_ps(x, one);
+			__m128 s;
+			switch(kernel){
+				case OFXTL_KERNEL_QUAD_IN:
+					s = _mm_mul_ps(x, x);
+					break;
+				case OFXTL_KERNEL_QUAD_OUT:
+					s = _mm_mul_ps(x, _mm_sub_ps(two, x));
+					break;
+				case OFXTL_KERNEL_CUBIC_IN:
+					s = _mm_mul_ps(_mm_mul_ps(x, x), x);
+					break;
+				case OFXTL_KERNEL_CUBIC_OUT:
+					s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(y, y), y), one);
+					break;
+				case OFXTL_KERNEL_CUBIC_IN_OUT:{
+					__m128 firstHalf = _mm_cmplt_ps(x, half);
+					__m128 easeIn = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(four, x), x), x);
+					__m128 easeOut = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(_mm_mul_ps(four, y), y), y), one);
+					s = _mm_or_ps(_mm_and_ps(firstHalf, easeIn), _mm_andnot_ps(firstHalf, easeOut));
+					break;
+				}
+				default:
+					s = x;
+					break;
+			}
+			_mm_storeu_ps(out + i, _mm_add_ps(start, _mm_mul_ps(range, s)));
+		}
+#elif defined(OFXTL_KERNELS_NEON)
+		float32x4_t invDuration = vdupq_n_f32(1.0f / duration);
+		float32x4_t start = vdupq_n_f32(from);
+		float32x4_t range = vdupq_n_f32(to - from);
+		float32x4_t one = vdupq_n_f32(1.0f);
+		float32x4_t two = vdupq_n_f32(2.0f);
+		float32x4_t four = vdupq_n_f32(4.0f);
+		float32x4_t half = vdupq_n_f32(0.5f);
+		for(; i + 4 <= count; i += 4){
+			float32x4_t x = vmulq_f32(vld1q_f32(elapsed + i), invDuration);
+			float32x4_t y = vsubq_f32(x, one);
+			float32x4_t s;
+			switch(kernel){
+				case OFXTL_KERNEL_QUAD_IN:
+					s = vmulq_f32(x, x);
+					break;
+				case OFXTL_KERNEL_QUAD_OUT:
+					s = vmulq_f32(x, vsubq_f32(two, x));
+					break;
+				case OFXTL_KERNEL_CUBIC_IN:
+					s = vmulq_f32(vmulq_f32(x, x), x);
+					break;
+				case OFXTL_KERNEL_CUBIC_OUT:
+					s = vaddq_f32(vmulq_f32(vmulq_f32(y, y), y), one);
+					break;
+				case OFXTL_KERNEL_CUBIC_IN_OUT:{
+					uint32x4_t firstHalf = vcltq_f32(x, half);
+					float32x4_t easeIn = vmulq_f32(vmulq_f32(vmulq_f32(four, x), x), x);
+					float32x4_t easeOut = vaddq_f32(vmulq_f32(vmulq_f32(vmulq_f32(four, y), y), y), one);
+					s = vbslq_f32(firstHalf, easeIn, easeOut);
+					break;
+				}
+				default:
+					s = x;
+					break;
+			}
+			vst1q_f32(out + i, vaddq_f32(start, vmulq_f32(range, s)));
+		}
+#endif
+		interpolateScalar(kernel, elapsed + i, duration, from, to, count - i, out + i);
+	}
+
+	//turn off to run everything through the scalar reference, for comparing output
+	static void setUseVectorized(bool vectorized){
+		useVectorized() = vectorized;
+	}
+
+	static bool& useVectorized(){
+		static bool vectorized = true;
+		return vectorized;
+	}
+
+	//which instruction set interpolateVectorized was built with
+	static string getInstructionSet(){
+#if defined(OFXTL_KERNELS_SSE)
+		return "SSE2";
+#elif defined(OFXTL_KERNELS_NEON)
+		return "NEON";
+#else
+		return "none";
+#endif
+	}
+};
@@ -38,50 +38,324 @@ bool keyframesort(ofxTLKeyframe* a, ofxTLKeyframe* b){
 	return a->time < b->time;
 }
 
+ofxTLKeyframeStore::ofxTLKeyframeStore()
+:	defaultValue(0),
+	duration(0)
+{
+}
+
+void ofxTLKeyframeStore::clear(){
+	times.clear();
+	values.clear();
+	keys.clear();
+}
+
+void ofxTLKeyframeStore::reserve(int numKeys){
+	times.reserve(numKeys);
+	values.reserve(numKeys);
+	keys.reserve(numKeys);
+}
+
+void ofxTLKeyframeStore::push(ofxTLKeyframe* key){
+	times.push_back(key->time);
+	values.push_back(key->value);
+	keys.push_back(key);
+}
+
+int ofxTLKeyframeStore::size(){
+	return times.size();
+}
+
+int ofxTLKeyframeStore::findSegmentEnd(unsigned long long sampleTime, ofxTLKeyframeCursor& cursor){
+	//optimization for linear playback, most samples land in the same or the next segment
+	int index = cursor.keyIndex;
+	if(index >= 1 && index < times.size() && times[index-1] < sampleTime){
+		if(sampleTime <= times[index]){
+			return index;
+		}
+		if(index+1 < times.size() && sampleTime <= times[index+1]){
+			cursor.keyIndex = index+1;
+			return index+1;
+		}
+	}
+	cursor.keyIndex = lower_bound(times.begin()+1, times.end(), sampleTime) - times.begin();
+	return cursor.keyIndex;
+}
+
+void ofxTLKeyframeStore::findKeysInRange(unsigned long long minTime, unsigned long long maxTime, int& startIndex, int& endIndex){
+	startIndex = lower_bound(times.begin(), times.end(), minTime) - times.begin();
+	endIndex = upper_bound(times.begin()+startIndex, times.end(), maxTime) - times.begin();
+}
+
+ofxTLPreviewEnvelope::ofxTLPreviewEnvelope()
+:	editedStart(0),
+	editedEnd(0),
+	dirtyStart(0),
+	dirtyEnd(0),
+	duration(0),
+	editedSpanSet(false)
+{
+}
+
+void ofxTLPreviewEnvelope::setup(unsigned long long newDuration, int numBuckets){
+	duration = newDuration;
+	levels.clear();
+	numBuckets = MAX(numBuckets, 1);
+	while(true){
+		levels.push_back(vector<Bucket>(numBuckets));
+		if(numBuckets == 1){
+			break;
+		}
+		numBuckets = (numBuckets+1)/2;
+	}
+	invalidateAll();
+}
+
+unsigned long long ofxTLPreviewEnvelope::getDuration(){
+	return duration;
+}
+
+void ofxTLPreviewEnvelope::invalidateAll(){
+	dirtyStart = 0;
+	dirtyEnd = levels.size() > 0 ? levels[0].size() : 0;
+	clearEditedSpan();
+}
+
+void ofxTLPreviewEnvelope::invalidate(unsigned long long startMillis, unsigned long long endMillis){
+	if(levels.size() == 0){
+		return;
+	}
+	double bucketMillis = getBucketMillis(0);
+	int startBucket = ofClamp(startMillis / bucketMillis, 0, levels[0].size()-1);
+	int endBucket = ofClamp(endMillis / bucketMillis, 0, levels[0].size()-1) + 1;
+	if(isDirty()){
+		dirtyStart = MIN(dirtyStart, startBucket);
+		dirtyEnd = MAX(dirtyEnd, endBucket);
+	}
+	else{
+		dirtyStart = startBucket;
+		dirtyEnd = endBucket;
+	}
+}
+
+bool ofxTLPreviewEnvelope::isDirty(){
+	return dirtyEnd > dirtyStart;
+}
+
+void ofxTLPreviewEnvelope::rebuildLevels(){
+	int start = dirtyStart;
+	int end = dirtyEnd;
+	for(int l = 1; l < levels.size(); l++){
+		vector<Bucket>& children = levels[l-1];
+		vector<Bucket>& parents = levels[l];
+		start /= 2;
+		end = (end+1)/2;
+		for(int p = start; p < end; p++){
+			Bucket& parent = parents[p];
+			parent = children[p*2];
+			if(p*2+1 < children.size()){
+				Bucket& child = children[p*2+1];
+				parent.min = MIN(parent.min, child.min);
+				parent.max = MAX(parent.max, child.max);
+				parent.last = child.last;
+			}
+		}
+	}
+	dirtyStart = dirtyEnd = 0;
+}
+
+void ofxTLPreviewEnvelope::addEditedSpan(unsigned long long startMillis, unsigned long long endMillis){
+	if(editedSpanSet){
+		editedStart = MIN(editedStart, startMillis);
+		editedEnd = MAX(editedEnd, endMillis);
+	}
+	else{
+		editedStart = startMillis;
+		editedEnd = endMillis;
+		editedSpanSet = true;
+	}
+}
+
+bool ofxTLPreviewEnvelope::hasEditedSpan(){
+	return editedSpanSet;
+}
+
+void ofxTLPreviewEnvelope::clearEditedSpan(){
+	editedSpanSet = false;
+}
+
+double ofxTLPreviewEnvelope::getBucketMillis(int level){
+	if(levels.size() == 0){
+		return 0;
+	}
+	return double(duration) / levels[0].size() * (1 << level);
+}
+
+int ofxTLPreviewEnvelope::getLevelForMillis(double maxMillis){
+	for(int l = levels.size()-1; l >= 0; l--){
+		if(getBucketMillis(l) <= maxMillis){
+			return l;
+		}
+	}
+	return -1;
+}
+
+ofxTLBakedSamples::ofxTLBakedSamples()
+:	duration(0),
+	rate(0)
+{
+}
+
+float ofxTLBakedSamples::sampleAtTime(long sampleTime){
+	if(samples.size() == 1 || duration == 0){
+		return samples[0];
+	}
+	//kept in double, a float position runs out of fractional bits past 2^24 samples
+	double position = MIN(MAX(sampleTime, 0L), (long)duration) * double(samples.size()-1) / duration;
+	int index = MIN(int(position), (int)samples.size()-2);
+	double alpha = position - index;
+	return samples[index] + (samples[index+1] - samples[index]) * alpha;
+}
+
+ofxTLKeyframeBaker::ofxTLKeyframeBaker()
+:	track(NULL)
+{
+}
+
+void ofxTLKeyframeBaker::threadedFunction(){
+	while(isThreadRunning()){
+		if(!track->bakeIfNeeded()){
+			ofSleepMillis(10);
+		}
+	}
+}
+
 ofxTLKeyframes::ofxTLKeyframes()
 :	hoverKeyframe(NULL),
 	keysAreDraggable(false),
 	keysDidDrag(false),
 	keysDidNudge(false),
-	lastKeyframeIndex(1),
-	lastSampleTime(0),
+	keyStoreIsDirty(true),
 	shouldRecomputePreviews(false),
 	createNewOnMouseup(false),
 	useBinarySave(false),
-	valueRange(ofRange(0,1.))
+	valueRange(ofRange(0,1.)),
+	bakeRate(0)
 {
 	xmlFileName = "_keyframes.xml";	
+	baker.track = this;
 }
 
 ofxTLKeyframes::~ofxTLKeyframes(){
+	stopBaking();
 	clear();
 }
 
+void ofxTLKeyframes::updatePreviewEnvelope(){
+	//finest level is at most 8192 buckets of at least a millisecond each
+	unsigned long long duration = timeline->getDurationInMilliseconds();
+	if(previewEnvelope.getDuration() != duration){
+		previewEnvelope.setup(duration, MIN(duration, 8192));
+	}
+	else if(shouldRecomputePreviews && !previewEnvelope.hasEditedSpan()){
+		//something changed that didn't say where
+		previewEnvelope.invalidateAll();
+	}
+	
+	ofxTLKeyframeStore& store = getKeyStore();
+	if(previewEnvelope.hasEditedSpan()){
+		//the line changes from the key before the edit up to the key after it
+		int startIndex, endIndex;
+		store.findKeysInRange(previewEnvelope.editedStart, previewEnvelope.editedEnd, startIndex, endIndex);
+		previewEnvelope.invalidate(startIndex > 0 ? store.times[startIndex-1] : 0,
+								   endIndex < store.size() ? store.times[endIndex] : duration);
+		previewEnvelope.clearEditedSpan();
+	}
+	
+	if(!previewEnvelope.isDirty()){
+		return;
+	}
+	
+	//a few samples across each bucket, taken in one sampleStoreRange pass over the dirty span,
+	//plus the keys inside each bucket which is where the extremes usually are
+	int samplesPerBucket = 4;
+	double bucketMillis = previewEnvelope.getBucketMillis(0);
+	vector<ofxTLPreviewEnvelope::Bucket>& buckets = previewEnvelope.levels[0];
+	previewSamples.resize((previewEnvelope.dirtyEnd - previewEnvelope.dirtyStart) * samplesPerBucket + 1);
+	sampleStoreRange(store, previewEnvelope.dirtyStart * bucketMillis, previewEnvelope.dirtyEnd * bucketMillis,
+					 previewSamples.size(), &previewSamples[0]);
+	ofxTLKeyframeCursor cursor;
+	for(int b = previewEnvelope.dirtyStart; b < previewEnvelope.dirtyEnd; b++){
+		unsigned long long bucketStart = b * bucketMillis;
+		unsigned long long bucketEnd = (b+1) * bucketMillis;
+		ofxTLPreviewEnvelope::Bucket& bucket = buckets[b];
+		float* samples = &previewSamples[(b - previewEnvelope.dirtyStart) * samplesPerBucket];
+		bucket.first = bucket.min = bucket.max = ofMap(samples[0], valueRange.min, valueRange.max, 0, 1.0, false);
+		for(int s = 1; s <= samplesPerBucket; s++){
+			float value = ofMap(samples[s], valueRange.min, valueRange.max, 0, 1.0, false);
+			bucket.min = MIN(bucket.min, value);
+			bucket.max = MAX(bucket.max, value);
+			bucket.last = value;
+		}
+		int startIndex, endIndex;
+		store.findKeysInRange(bucketStart, bucketEnd, startIndex, endIndex);
+		for(int i = startIndex; i < endIndex; i++){
+			float value = sampleStoreAtTime(store, store.times[i], cursor);
+			bucket.min = MIN(bucket.min, value);
+			bucket.max = MAX(bucket.max, value);
+		}
+	}
+	previewEnvelope.rebuildLevels();
+}
+
 void ofxTLKeyframes::recomputePreviews(){
 	preview.clear();
 	
-//	cout << "ofxTLKeyframes::recomputePreviews " << endl;
+	updatePreviewEnvelope();
 	
-//	if(keyframes.size() == 0 || keyframes.size() == 1){
-//		preview.addVertex(ofPoint(bounds.x, bounds.y + bounds.height - sampleAtPercent(.5f)*bounds.height));
-//		preview.addVertex(ofPoint(bounds.x+bounds.width, bounds.y + bounds.height - sampleAtPercent(.5f)*bounds.height));
-//	}
-//	else{
-		for(int p = bounds.getMinX(); p <= bounds.getMaxX(); p+=2){
-			preview.addVertex(p,  bounds.y + bounds.height - sampleAtPercent(screenXtoNormalizedX(p)) * bounds.height);
+	//draw from the coarsest level that still has a bucket every couple of pixels
+	long visibleStart = screenXToMillis(bounds.getMinX());
+	long visibleEnd = screenXToMillis(bounds.getMaxX());
+	double millisPerPixel = (visibleEnd - visibleStart) / MAX(bounds.width, 1.0f);
+	int level = previewEnvelope.getLevelForMillis(millisPerPixel * 2);
+	if(level >= 0){
+		vector<ofxTLPreviewEnvelope::Bucket>& buckets = previewEnvelope.levels[level];
+		double bucketMillis = previewEnvelope.getBucketMillis(level);
+		int firstBucket = ofClamp(visibleStart / bucketMillis, 0, buckets.size()-1);
+		int lastBucket = ofClamp(visibleEnd / bucketMillis, 0, buckets.size()-1);
+		for(int b = firstBucket; b <= lastBucket; b++){
+			ofxTLPreviewEnvelope::Bucket& bucket = buckets[b];
+			float x = ofClamp(millisToScreenX((b + .5) * bucketMillis), bounds.getMinX(), bounds.getMaxX());
+			//go through the extremes in the same direction the line travels
+			float fromValue = bucket.first <= bucket.last ? bucket.min : bucket.max;
+			float toValue = bucket.first <= bucket.last ? bucket.max : bucket.min;
+			preview.addVertex(x, bounds.y + bounds.height - fromValue * bounds.height);
+			if(fromValue != toValue){
+				preview.addVertex(x, bounds.y + bounds.height - toValue * bounds.height);
+			}
 		}
-//	}
+	}
+	else{
+		//zoomed in further than the finest level, sample directly every couple of pixels
+		previewSamples.resize(MAX(bounds.width/2, 1) + 1);
+		sampleStoreRange(getKeyStore(), visibleStart, visibleEnd, previewSamples.size(), &previewSamples[0]);
+		for(int i = 0; i < previewSamples.size(); i++){
+			float value = ofMap(previewSamples[i], valueRange.min, valueRange.max, 0, 1.0, false);
+			preview.addVertex(bounds.x + bounds.width * i / (previewSamples.size()-1), bounds.y + bounds.height - value * bounds.height);
+		}
+	}
 //	int size = preview.getVertices().size();
 	preview.simplify();
 	//cout << "simplify pre " << size << " post: " << preview.getVertices().size() << " dif: " << (size - preview.getVertices().size()) << endl;
 
 	ofVec2f lastPoint;
 	keyPoints.clear();
-	for(int i = 0; i < keyframes.size(); i++){
-		if(!isKeyframeIsInBounds(keyframes[i])){
+	ofxTLKeyframeStore& store = getKeyStore();
+	for(int i = 0; i < store.size(); i++){
+		if(!isTimeInBounds(store.times[i])){
 			continue;
 		}
-		ofVec2f screenpoint = screenPositionForKeyframe(keyframes[i]);
+		ofVec2f screenpoint = ofVec2f(millisToScreenX(store.times[i]), valueToScreenY(store.values[i]));
 		if(lastPoint.squareDistance(screenpoint) > 5*5){
 			keyPoints.push_back(screenpoint);
 		}
@@ -99,7 +373,7 @@ void ofxTLKeyframes::draw(){
 		return;
 	}
 	
-	if(shouldRecomputePreviews || viewIsDirty){
+	if(shouldRecomputePreviews || viewIsDirty || previewEnvelope.hasEditedSpan()){
 		recomputePreviews();
 	}
 	
@@ -160,18 +434,22 @@ void ofxTLKeyframes::draw(){
 void ofxTLKeyframes::setValueRange(ofRange range, float newDefaultValue){
 	valueRange = range;
     defaultValue = newDefaultValue;
+	keyStoreIsDirty = true;
 }
 
 void ofxTLKeyframes::setValueRangeMin(float min){
 	valueRange.min = min;
+	keyStoreIsDirty = true;
 }
 
 void ofxTLKeyframes::setValueRangeMax(float max){
 	valueRange.max = max;
+	keyStoreIsDirty = true;
 }
 
 void ofxTLKeyframes::setDefaultValue(float newDefaultValue){
 	defaultValue = newDefaultValue;
+	keyStoreIsDirty = true;
 }
 
 void ofxTLKeyframes::quantizeKeys(int step){
@@ -195,7 +473,75 @@ float ofxTLKeyframes::getValueAtPercent(float percent){
 }
 
 float ofxTLKeyframes::getValueAtTimeInMillis(long sampleTime){
-	return ofMap(sampleAtTime(sampleTime), 0.0, 1.0, valueRange.min, valueRange.max, false);
+	return getValueAtTimeInMillis(sampleTime, playbackCursor);
+}
+
+float ofxTLKeyframes::getValueAtTimeInMillis(long sampleTime, ofxTLKeyframeCursor& cursor){
+	if(bakeRate > 0){
+		ofPtr<ofxTLBakedSamples> bake = getCurrentBake();
+		if(bake != NULL){
+			return bake->sampleAtTime(sampleTime);
+		}
+	}
+	return ofMap(sampleAtTime(sampleTime, cursor), 0.0, 1.0, valueRange.min, valueRange.max, false);
+}
+
+float ofxTLKeyframes::getValueAtTimeInMillis(ofxTLKeyframeStore& snapshot, long sampleTime, ofxTLKeyframeCursor& cursor){
+	return ofMap(sampleStoreAtTime(snapshot, sampleTime, cursor), 0.0, 1.0, snapshot.valueRange.min, snapshot.valueRange.max, false);
+}
+
+ofPtr<ofxTLKeyframeStore> ofxTLKeyframes::getKeyframeSnapshot(){
+	snapshotLock.lock();
+	ofPtr<ofxTLKeyframeStore> snapshot = keyStore;
+	snapshotLock.unlock();
+	//nothing has been published yet, hand out an empty store
+	if(snapshot == NULL){
+		snapshot = ofPtr<ofxTLKeyframeStore>(new ofxTLKeyframeStore());
+	}
+	return snapshot;
+}
+
+void ofxTLKeyframes::sampleRange(unsigned long long startMillis, unsigned long long endMillis, int count, float* out){
+	sampleStoreRange(getKeyStore(), startMillis, endMillis, count, out);
+}
+
+void ofxTLKeyframes::sampleRange(ofxTLKeyframeStore& snapshot, unsigned long long startMillis, unsigned long long endMillis, int count, float* out){
+	sampleStoreRange(snapshot, startMillis, endMillis, count, out);
+}
+
+void ofxTLKeyframes::sampleStoreRange(ofxTLKeyframeStore& store, unsigned long long startMillis, unsigned long long endMillis, int count, float* out){
+	int numKeys = store.size();
+	if(numKeys == 0){
+		for(int i = 0; i < count; i++){
+			out[i] = store.defaultValue;
+		}
+		return;
+	}
+	
+	ofxTLKeyframeCursor cursor;
+	for(int i = 0; i < count; i++){
+		unsigned long long sampleTime = rangeSampleTime(store, startMillis, endMillis, count, i);
+		float sample;
+		if(sampleTime <= store.times[0]){
+			sample = evaluateStoredKeyAtTime(store, 0, sampleTime, true);
+		}
+		else if(sampleTime >= store.times[numKeys-1]){
+			sample = evaluateStoredKeyAtTime(store, numKeys-1, sampleTime);
+		}
+		else{
+			int k = store.findSegmentEnd(sampleTime, cursor);
+			sample = interpolateValueForStoredKeys(store, k-1, k, sampleTime);
+		}
+		out[i] = ofMap(sample, 0.0, 1.0, store.valueRange.min, store.valueRange.max, false);
+	}
+}
+
+unsigned long long ofxTLKeyframes::rangeSampleTime(ofxTLKeyframeStore& store, unsigned long long startMillis, unsigned long long endMillis, int count, int i){
+	double sampleTime = startMillis;
+	if(count > 1){
+		sampleTime += (double(endMillis) - double(startMillis)) * i / (count-1);
+	}
+	return MIN(MAX(sampleTime, 0.0), double(store.duration));
 }
 
 float ofxTLKeyframes::sampleAtPercent(float percent){
@@ -203,36 +549,33 @@ float ofxTLKeyframes::sampleAtPercent(float percent){
 }
 
 float ofxTLKeyframes::sampleAtTime(long sampleTime){
-	sampleTime = ofClamp(sampleTime, 0, timeline->getDurationInMilliseconds());
+	return sampleAtTime(sampleTime, playbackCursor);
+}
+
+float ofxTLKeyframes::sampleAtTime(long sampleTime, ofxTLKeyframeCursor& cursor){
+	return sampleStoreAtTime(getKeyStore(), sampleTime, cursor);
+}
+
+float ofxTLKeyframes::sampleStoreAtTime(ofxTLKeyframeStore& store, long sampleTime, ofxTLKeyframeCursor& cursor){
+	sampleTime = MIN(MAX(sampleTime, 0L), (long)store.duration);
 	
-	//edge cases
-	if(keyframes.size() == 0){
-		return ofMap(defaultValue, valueRange.min, valueRange.max, 0, 1.0, true);
-	}
+	int numKeys = store.size();
 	
-	if(sampleTime <= keyframes[0]->time){
-		return evaluateKeyframeAtTime(keyframes[0], sampleTime, true);
+	//edge cases
+	if(numKeys == 0){
+		return ofMap(store.defaultValue, store.valueRange.min, store.valueRange.max, 0, 1.0, true);
 	}
 	
-	if(sampleTime >= keyframes[keyframes.size()-1]->time){
-		return evaluateKeyframeAtTime(keyframes[keyframes.size()-1], sampleTime);
+	if(sampleTime <= store.times[0]){
+		return evaluateStoredKeyAtTime(store, 0, sampleTime, true);
 	}
 	
-	//optimization for linear playback
-	int startKeyframeIndex = 1;
-	if(sampleTime >= lastSampleTime){
-		startKeyframeIndex = lastKeyframeIndex;
+	if(sampleTime >= store.times[numKeys-1]){
+		return evaluateStoredKeyAtTime(store, numKeys-1, sampleTime);
 	}
 	
-	for(int i = startKeyframeIndex; i < keyframes.size(); i++){
-		if(keyframes[i]->time >= sampleTime){
-			lastKeyframeIndex = i;
-			lastSampleTime = sampleTime;
-			return interpolateValueForKeys(keyframes[i-1], keyframes[i], sampleTime);
-		}
-	}
-	ofLog(OF_LOG_ERROR, "ofxTLKeyframes --- Error condition, couldn't find keyframe for percent " + ofToString(sampleTime));
-	return defaultValue;
+	int i = store.findSegmentEnd(sampleTime, cursor);
+	return interpolateValueForStoredKeys(store, i-1, i, sampleTime);
 }
 
 float ofxTLKeyframes::evaluateKeyframeAtTime(ofxTLKeyframe* key, unsigned long long sampleTime, bool firstKey){
@@ -243,6 +586,122 @@ float ofxTLKeyframes::interpolateValueForKeys(ofxTLKeyframe* start,ofxTLKeyframe
 	return ofMap(sampleTime, start->time, end->time, start->value, end->value);
 }
 
+float ofxTLKeyframes::evaluateStoredKeyAtTime(ofxTLKeyframeStore& store, int index, unsigned long long sampleTime, bool firstKey){
+	return store.values[index];
+}
+
+float ofxTLKeyframes::interpolateValueForStoredKeys(ofxTLKeyframeStore& store, int startIndex, int endIndex, unsigned long long sampleTime){
+	return ofMap(sampleTime, store.times[startIndex], store.times[endIndex], store.values[startIndex], store.values[endIndex]);
+}
+
+ofxTLKeyframeStore* ofxTLKeyframes::newKeyframeStore(){
+	return new ofxTLKeyframeStore();
+}
+
+void ofxTLKeyframes::setBakeRate(float samplesPerSecond){
+	if(samplesPerSecond > 0 && bakeRate <= 0){
+		snapshotLock.lock();
+		bakeRate = samplesPerSecond;
+		snapshotLock.unlock();
+		baker.startThread();
+	}
+	else if(samplesPerSecond <= 0 && bakeRate > 0){
+		stopBaking();
+		snapshotLock.lock();
+		bakeRate = 0;
+		bakedSamples.reset();
+		snapshotLock.unlock();
+	}
+	else{
+		snapshotLock.lock();
+		bakeRate = samplesPerSecond;
+		snapshotLock.unlock();
+	}
+}
+
+float ofxTLKeyframes::getBakeRate(){
+	return bakeRate;
+}
+
+bool ofxTLKeyframes::isBaked(){
+	return bakeRate > 0 && getCurrentBake() != NULL;
+}
+
+void ofxTLKeyframes::stopBaking(){
+	if(baker.isThreadRunning()){
+		baker.waitForThread(true);
+	}
+}
+
+ofPtr<ofxTLBakedSamples> ofxTLKeyframes::getCurrentBake(){
+	if(keyStoreNeedsRebuild()){
+		return ofPtr<ofxTLBakedSamples>();
+	}
+	snapshotLock.lock();
+	ofPtr<ofxTLBakedSamples> bake = bakedSamples;
+	bool current = bake != NULL && bake->source == keyStore && bake->rate == bakeRate;
+	snapshotLock.unlock();
+	if(!current){
+		return ofPtr<ofxTLBakedSamples>();
+	}
+	return bake;
+}
+
+bool ofxTLKeyframes::bakeIfNeeded(){
+	//the store carries the value range and duration it was built with,
+	//so nothing else of the track's needs to be read on this thread
+	snapshotLock.lock();
+	ofPtr<ofxTLKeyframeStore> snapshot = keyStore;
+	float rate = bakeRate;
+	bool current = bakedSamples != NULL && bakedSamples->source == snapshot && bakedSamples->rate == rate;
+	snapshotLock.unlock();
+	//wait for the first store to be published, or for the next edit
+	if(snapshot == NULL || rate <= 0 || current){
+		return false;
+	}
+	
+	ofPtr<ofxTLBakedSamples> bake = ofPtr<ofxTLBakedSamples>(new ofxTLBakedSamples());
+	bake->source = snapshot;
+	bake->duration = snapshot->duration;
+	bake->rate = rate;
+	bake->samples.resize(bake->duration * double(bake->rate) / 1000 + 1);
+	sampleStoreRange(*snapshot, 0, bake->duration, bake->samples.size(), &bake->samples[0]);
+	
+	snapshotLock.lock();
+	bakedSamples = bake;
+	snapshotLock.unlock();
+	return true;
+}
+
+bool ofxTLKeyframes::keyStoreNeedsRebuild(){
+	if(keyStore == NULL || keyStoreIsDirty){
+		return true;
+	}
+	//tracks can be cleared before they've been added to a timeline
+	return timeline != NULL && keyStore->duration != timeline->getDurationInMilliseconds();
+}
+
+ofxTLKeyframeStore& ofxTLKeyframes::getKeyStore(){
+	if(keyStoreNeedsRebuild()){
+		//build a new store instead of refilling the current one,
+		//other threads may still be sampling it as a snapshot
+		ofPtr<ofxTLKeyframeStore> newStore = ofPtr<ofxTLKeyframeStore>(newKeyframeStore());
+		newStore->reserve(keyframes.size());
+		for(int i = 0; i < keyframes.size(); i++){
+			newStore->push(keyframes[i]);
+		}
+		newStore->finish();
+		newStore->valueRange = valueRange;
+		newStore->defaultValue = defaultValue;
+		newStore->duration = timeline != NULL ? timeline->getDurationInMilliseconds() : 0;
+		snapshotLock.lock();
+		keyStore = newStore;
+		snapshotLock.unlock();
+		keyStoreIsDirty = false;
+	}
+	return *keyStore;
+}
+
 void ofxTLKeyframes::load(){
     clear();
 	if(useBinarySave){
@@ -308,10 +767,19 @@ void ofxTLKeyframes::clear(){
 
 	for(int i = 0; i < keyframes.size(); i++){
 		willDeleteKeyframe(keyframes[i]);
-		delete keyframes[i];
+	}
+	//when every key came from the pool, release them in one go
+	if(keyPool != NULL && keyPool->getNumAllocated() == keyframes.size()){
+		keyPool->releaseAll();
+	}
+	else{
+		for(int i = 0; i < keyframes.size(); i++){
+			disposeKeyframe(keyframes[i]);
+		}
 	}
 	keyframes.clear();
     selectedKeyframes.clear();
+	movedKeyframes.clear();
 	updateKeyframeSort();
 }
 
@@ -395,7 +863,7 @@ bool ofxTLKeyframes::mousePressed(ofMouseEventArgs& args, long millis){
 	if(selectedKeyframe != NULL){
          //add the keyframe to the selection, whether it was just generated or not
     	if(!isKeyframeSelected(selectedKeyframe)){
-			selectedKeyframes.push_back(selectedKeyframe);
+			selectKeyframe(selectedKeyframe);
 			updateKeyframeSort();
 //			selectKeyframe(selectedKeyframe);
         }
@@ -428,8 +896,11 @@ bool ofxTLKeyframes::mousePressed(ofMouseEventArgs& args, long millis){
 }
 
 void ofxTLKeyframes::regionSelected(ofLongRange timeRange, ofRange valueRange){
-    for(int i = 0; i < keyframes.size(); i++){
-        if(timeRange.contains(keyframes[i]->time) && valueRange.contains(1.-keyframes[i]->value)){
+	ofxTLKeyframeStore& store = getKeyStore();
+	int startIndex, endIndex;
+	getKeyIndicesInRange(timeRange, startIndex, endIndex);
+    for(int i = startIndex; i < endIndex; i++){
+        if(valueRange.contains(1.-store.values[i])){
             selectKeyframe(keyframes[i]);
         }
 	}
@@ -493,41 +964,38 @@ void ofxTLKeyframes::mouseDragged(ofMouseEventArgs& args, long millis){
 void ofxTLKeyframes::updateKeyframeSort(){
 	//reset these caches because they may no longer be valid
 	shouldRecomputePreviews = true;
-	lastKeyframeIndex = 1;
-	lastSampleTime = 0;
+	keyStoreIsDirty = true;
+	playbackCursor.reset();
 	if(keyframes.size() > 1){
-		//modify duration to fit
-		for(int i = 0; i < keyframes.size(); i++){
-			if(keyframes[i]->time > timeline->getDurationInMilliseconds()){
-				//keyframes[i]->time = timeline->getDurationInMilliseconds();
-				timeline->setDurationInMillis(keyframes[i]->time);
+		//when only a few keys moved put just those back in place,
+		//otherwise or if that fails do the full sort
+		if(movedKeyframes.size() > keyframes.size()/4 || !resortMovedKeyframes()){
+			sort(keyframes.begin(), keyframes.end(), keyframesort);
+			previewEnvelope.invalidateAll();
+			for(int i = 0; i < keyframes.size()-1; i++){
+				separateKeyframes(i);
 			}
 		}
 		
-		sort(keyframes.begin(), keyframes.end(), keyframesort);
-		
-		for(int i = 0; i < keyframes.size()-1; i++){
-			if(keyframes[i]->time == keyframes[i+1]->time){
-				if(keyframes[i]->previousTime < keyframes[i+1]->time){
-					keyframes[i]->time -= 1;
-				}
-				else{
-					keyframes[i+1]->time+=1;
-				}
-			}
+		//modify duration to fit, the keys are in order so only the last one matters
+		if(keyframes.back()->time > timeline->getDurationInMilliseconds()){
+			timeline->setDurationInMillis(keyframes.back()->time);
 		}
+		
 		if(selectedKeyframes.size() > 1){
 			sort(selectedKeyframes.begin(), selectedKeyframes.end(), keyframesort);
 		}
 	}
+	movedKeyframes.clear();
+	//publish the edit right away for threads sampling from snapshots
+	getKeyStore();
 }
 
 void ofxTLKeyframes::mouseReleased(ofMouseEventArgs& args, long millis){
 	keysAreDraggable = false;
     if(keysDidDrag){
 		//reset these caches because they may no longer be valid
-		lastKeyframeIndex = 1;
-		lastSampleTime = 0;
+		playbackCursor.reset();
         timeline->flagTrackModified(this);
     }
 	
@@ -537,22 +1005,97 @@ void ofxTLKeyframes::mouseReleased(ofMouseEventArgs& args, long millis){
 		setKeyframeTime(selectedKeyframe,millis);
 		selectedKeyframe->value = screenYToValue(args.y);
 		keyframes.push_back(selectedKeyframe);
-		selectedKeyframes.push_back(selectedKeyframe);
+		selectKeyframe(selectedKeyframe);
 		updateKeyframeSort();
 		timeline->flagTrackModified(this);
 	}
 	createNewOnMouseup = false;
 }
 
+bool ofxTLKeyframes::resortMovedKeyframes(){
+	sort(movedKeyframes.begin(), movedKeyframes.end());
+	movedKeyframes.erase(unique(movedKeyframes.begin(), movedKeyframes.end()), movedKeyframes.end());
+	
+	//pull the moved keys out, compacting the rest to the front
+	vector<ofxTLKeyframe*> moved;
+	bool restInOrder = true;
+	int numStayed = 0;
+	for(int i = 0; i < keyframes.size(); i++){
+		if(binary_search(movedKeyframes.begin(), movedKeyframes.end(), keyframes[i])){
+			moved.push_back(keyframes[i]);
+		}
+		else{
+			//a key that was changed without setKeyframeTime, or appended out of order
+			if(numStayed > 0 && keyframes[i]->time < keyframes[numStayed-1]->time){
+				restInOrder = false;
+			}
+			keyframes[numStayed++] = keyframes[i];
+		}
+	}
+	
+	if(!restInOrder){
+		//put everything back so the caller can sort it all
+		for(int i = 0; i < moved.size(); i++){
+			keyframes[numStayed+i] = moved[i];
+		}
+		return false;
+	}
+	
+	//merge the moved keys back in, remembering where they landed
+	sort(moved.begin(), moved.end(), keyframesort);
+	vector<ofxTLKeyframe*> merged;
+	vector<int> movedPositions;
+	merged.reserve(keyframes.size());
+	int stayedIndex = 0;
+	int movedIndex = 0;
+	while(stayedIndex < numStayed || movedIndex < moved.size()){
+		if(movedIndex < moved.size() && (stayedIndex == numStayed || moved[movedIndex]->time < keyframes[stayedIndex]->time)){
+			movedPositions.push_back(merged.size());
+			merged.push_back(moved[movedIndex++]);
+		}
+		else{
+			merged.push_back(keyframes[stayedIndex++]);
+		}
+	}
+	keyframes.swap(merged);
+	
+	//only the neighborhoods of moved keys can have new collisions
+	for(int p = 0; p < movedPositions.size(); p++){
+		for(int i = MAX(movedPositions[p]-1, 0); i < keyframes.size()-1; i++){
+			if(keyframes[i]->time == keyframes[i+1]->time){
+				separateKeyframes(i);
+			}
+			else if(i >= movedPositions[p]){
+				break;
+			}
+		}
+	}
+	return true;
+}
+
+void ofxTLKeyframes::separateKeyframes(int index){
+	if(keyframes[index]->time == keyframes[index+1]->time){
+		if(keyframes[index]->previousTime < keyframes[index+1]->time){
+			keyframes[index]->time -= 1;
+		}
+		else{
+			keyframes[index+1]->time+=1;
+		}
+	}
+}
+
 void ofxTLKeyframes::setKeyframeTime(ofxTLKeyframe* key, unsigned long long newTime){
 	key->previousTime = key->time;
 	key->time = newTime;
+	movedKeyframes.push_back(key);
+	previewEnvelope.addEditedSpan(MIN(key->previousTime, newTime), MAX(key->previousTime, newTime));
 }
 
 void ofxTLKeyframes::getSnappingPoints(set<unsigned long long>& points){
-	for(int i = 0; i < keyframes.size(); i++){
-		if (isKeyframeIsInBounds(keyframes[i]) && !isKeyframeSelected(keyframes[i])) {
-			points.insert(keyframes[i]->time);
+	ofxTLKeyframeStore& store = getKeyStore();
+	for(int i = 0; i < store.size(); i++){
+		if (isTimeInBounds(store.times[i]) && !isKeyframeSelected(keyframes[i])) {
+			points.insert(store.times[i]);
 		}
 	}
 }
@@ -592,12 +1135,13 @@ void ofxTLKeyframes::pasteSent(string pasteboard){
 				keyContainer[i]->time -= keyContainer[0]->time;
 				keyContainer[i]->time += timeline->getCurrentTimeMillis();
 				if(keyContainer[i]->time <= timeline->getDurationInMilliseconds()){
-					selectedKeyframes.push_back(keyContainer[i]);
+					selectKeyframe(keyContainer[i]);
 					keyframes.push_back(keyContainer[i]);
 					numKeyframesPasted++;
 				}
 				else{
-					delete keyContainer[i];
+					willDeleteKeyframe(keyContainer[i]);
+					disposeKeyframe(keyContainer[i]);
 				}
 			}
 
@@ -631,20 +1175,46 @@ void ofxTLKeyframes::addKeyframeAtMillis(float value, unsigned long long millis)
 	key->time = key->previousTime = millis;
 	key->value = ofMap(value, valueRange.min, valueRange.max, 0, 1.0, true);
 	keyframes.push_back(key);
+	previewEnvelope.addEditedSpan(millis, millis);
 	//smart sort, only sort if not added to end
-	if(keyframes.size() > 2 && keyframes[keyframes.size()-2]->time > keyframes[keyframes.size()-1]->time){
+	if(keyframes.size() > 1 && keyframes[keyframes.size()-2]->time > keyframes[keyframes.size()-1]->time){
 		updateKeyframeSort();
 	}
-	lastKeyframeIndex = 1;
+	//appending in order, like when recording, doesn't need the whole store rebuilt
+	//as long as no other thread is holding on to it. the last bake's reference doesn't count,
+	//the bake just stops being current. while the baker is partway through a bake, or someone
+	//has a snapshot, the key goes into a new store instead, so that happens at most once a bake
+	else if(!keyStoreIsDirty && keyStore != NULL){
+		snapshotLock.lock();
+		bool bakeHoldsStore = bakedSamples != NULL && bakedSamples->source == keyStore;
+		keyStoreIsDirty = keyStore.use_count() > (bakeHoldsStore ? 2 : 1);
+		if(!keyStoreIsDirty){
+			if(bakeHoldsStore){
+				bakedSamples->source.reset();
+			}
+			keyStore->push(key);
+			keyStore->finish();
+		}
+		snapshotLock.unlock();
+	}
+	else{
+		keyStoreIsDirty = true;
+	}
 	timeline->flagTrackModified(this);
 	shouldRecomputePreviews = true;
 }
 
 void ofxTLKeyframes::selectAll(){
+	for(int i = 0; i < keyframes.size(); i++){
+		keyframes[i]->selected = true;
+	}
 	selectedKeyframes = keyframes;
 }
 
 void ofxTLKeyframes::unselectAll(){
+	for(int i = 0; i < selectedKeyframes.size(); i++){
+		selectedKeyframes[i]->selected = false;
+	}
 	selectedKeyframes.clear();
 }
 
@@ -743,6 +1313,7 @@ void ofxTLKeyframes::loadFromBinaryFile(){
 		infile.read( (char*)&k->value, sizeof(float) );
 		keyframes.push_back(k);
 	}
+	keyStoreIsDirty = true;
 	shouldRecomputePreviews = true;
 }
 
@@ -763,24 +1334,22 @@ void ofxTLKeyframes::nudgeBy(ofVec2f nudgePercent){
 }
 
 void ofxTLKeyframes::deleteSelectedKeyframes(){
-	//vector<ofxTLKeyframe*>::iterator selectedIt = selectedKeyframes.end();
-	for(int i = keyframes.size() - 1; i >= 0; i--){
-		if(isKeyframeSelected(keyframes[i])){
-			if(keyframes[i] != selectedKeyframes[selectedKeyframes.size()-1]){
-				ofLogError("ofxTLKeyframes::deleteSelectedKeyframes") << "keyframe delete inconsistency";
-			}
+	//compact the unselected keys to the front in a single pass
+	int numKept = 0;
+	for(int i = 0; i < keyframes.size(); i++){
+		if(keyframes[i]->selected){
+			previewEnvelope.addEditedSpan(keyframes[i]->time, keyframes[i]->time);
 			willDeleteKeyframe(keyframes[i]);
 			if(keyframes[i] == hoverKeyframe){
 				hoverKeyframe = NULL;
 			}
-			delete keyframes[i];
-			keyframes.erase(keyframes.begin()+i);
-			//if(selectedIt != selectedKeyframes.begin()){
-//				selectedIt--;
-				selectedKeyframes.erase(--selectedKeyframes.end());
-			//}
+			disposeKeyframe(keyframes[i]);
+		}
+		else{
+			keyframes[numKept++] = keyframes[i];
 		}
 	}
+	keyframes.resize(numKept);
 	
 	selectedKeyframes.clear();
 	updateKeyframeSort();
@@ -795,9 +1364,11 @@ void ofxTLKeyframes::deleteKeyframe(ofxTLKeyframe* keyframe){
 	for(int i = keyframes.size() - 1; i >= 0; i--){
 		if(keyframe == keyframes[i]){
 			deselectKeyframe(keyframe);
+			previewEnvelope.addEditedSpan(keyframes[i]->time, keyframes[i]->time);
 			willDeleteKeyframe(keyframes[i]);
-			delete keyframes[i];
+			disposeKeyframe(keyframes[i]);
 			keyframes.erase(keyframes.begin()+i);
+			keyStoreIsDirty = true;
 			return;
 		}
 	}
@@ -808,7 +1379,9 @@ ofxTLKeyframe* ofxTLKeyframes::keyframeAtScreenpoint(ofVec2f p){
 		return NULL;	
 	}
 	float minDistanceSquared = 15*15;
-	for(int i = 0; i < keyframes.size(); i++){
+	int startIndex, endIndex;
+	getKeyIndicesNearScreenX(p.x, 15, startIndex, endIndex);
+	for(int i = startIndex; i < endIndex; i++){
 		if(isKeyframeIsInBounds(keyframes[i]) &&
 		   p.squareDistance(screenPositionForKeyframe(keyframes[i])) < minDistanceSquared)
 		{
@@ -818,13 +1391,33 @@ ofxTLKeyframe* ofxTLKeyframes::keyframeAtScreenpoint(ofVec2f p){
 	return NULL;
 }
 
+void ofxTLKeyframes::getKeyIndicesInRange(ofLongRange timeRange, int& startIndex, int& endIndex){
+	if(timeRange.max < 0){
+		startIndex = endIndex = 0;
+		return;
+	}
+	getKeyStore().findKeysInRange(MAX(timeRange.min, 0), timeRange.max, startIndex, endIndex);
+}
+
+void ofxTLKeyframes::getKeyIndicesNearScreenX(float screenX, float distance, int& startIndex, int& endIndex){
+	//pad by a millisecond so rounding in the screen conversion can't drop an edge key,
+	//callers still do their own exact test on the candidates
+	getKeyIndicesInRange(ofLongRange(screenXToMillis(screenX - distance) - 1, screenXToMillis(screenX + distance) + 1),
+						 startIndex, endIndex);
+}
+
 void ofxTLKeyframes::selectKeyframe(ofxTLKeyframe* k){
 	if(!isKeyframeSelected(k)){
+		k->selected = true;
         selectedKeyframes.push_back(k);
     }
 }
 
 void ofxTLKeyframes::deselectKeyframe(ofxTLKeyframe* k){
+	if(!isKeyframeSelected(k)){
+		return;
+	}
+	k->selected = false;
 	for(int i = 0; i < selectedKeyframes.size(); i++){
         if(selectedKeyframes[i] == k){
             selectedKeyframes.erase(selectedKeyframes.begin() + i);
@@ -837,19 +1430,17 @@ bool ofxTLKeyframes::isKeyframeSelected(ofxTLKeyframe* k){
 	
 	if(k == NULL) return false;
 
-	return binary_search(selectedKeyframes.begin(), selectedKeyframes.end(), k, keyframesort);
-//	for(int i = 0; i < selectedKeyframes.size(); i++){
-//		if(selectedKeyframes[i] == k){
-//			return true;
-//		}
-//	}
-//	return false;
+	return k->selected;
 }
 
 bool ofxTLKeyframes::isKeyframeIsInBounds(ofxTLKeyframe* key){
+	return isTimeInBounds(key->time);
+}
+
+bool ofxTLKeyframes::isTimeInBounds(unsigned long long time){
 	if(zoomBounds.min == 0.0 && zoomBounds.max == 1.0) return true;
 	unsigned long long duration = timeline->getDurationInMilliseconds();
-	return key->time >= zoomBounds.min*duration && key->time <= zoomBounds.max*duration;
+	return time >= zoomBounds.min*duration && time <= zoomBounds.max*duration;
 }
 
 ofVec2f ofxTLKeyframes::screenPositionForKeyframe(ofxTLKeyframe* keyframe){
@@ -870,10 +1461,16 @@ float ofxTLKeyframes::valueToScreenY(float value){
 }
 
 ofxTLKeyframe* ofxTLKeyframes::newKeyframe(){
-	ofxTLKeyframe* k = new ofxTLKeyframe();
+	ofxTLKeyframe* k = allocateKeyframe<ofxTLKeyframe>();
 	return k;
 }
 
+void ofxTLKeyframes::disposeKeyframe(ofxTLKeyframe* key){
+	if(keyPool == NULL || !keyPool->release(key)){
+		delete key;
+	}
+}
+
 string ofxTLKeyframes::getTrackType(){
     return "Keyframes";
 }
\ No newline at end of file
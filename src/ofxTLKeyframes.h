@@ -39,12 +39,255 @@
 
 class ofxTLKeyframe {
   public:
+	ofxTLKeyframe()
+	:	previousTime(0),
+		time(0),
+		value(0),
+		grabTimeOffset(0),
+		grabValueOffset(0),
+		selected(false)
+	{}
+
 	ofVec2f screenPosition; // cached screen position
 	unsigned long long previousTime; //for preventing overlap conflicts
     unsigned long long time; //in millis
     float value; //normalized
     long grabTimeOffset;
     float grabValueOffset;
+	bool selected; //owned by the track, use selectKeyframe and deselectKeyframe to change it
+};
+
+//hands out keyframes from large blocks instead of making one heap allocation per key.
+//freed keys are recycled, and a whole track's worth can be released at once on clear or undo
+class ofxTLKeyframePool {
+  public:
+	virtual ~ofxTLKeyframePool(){};
+	virtual ofxTLKeyframe* allocate() = 0;
+	//returns false if the key didn't come from this pool
+	virtual bool release(ofxTLKeyframe* key) = 0;
+	//destroys every key still allocated, keeping the blocks around for reuse
+	virtual void releaseAll() = 0;
+	virtual int getNumAllocated() = 0;
+};
+
+template<typename KeyType>
+class ofxTLTypedKeyframePool : public ofxTLKeyframePool {
+  public:
+	ofxTLTypedKeyframePool(){
+		numAllocated = 0;
+	}
+
+	virtual ~ofxTLTypedKeyframePool(){
+		releaseAll();
+		for(int i = 0; i < blocks.size(); i++){
+			::operator delete(blocks[i].keys);
+		}
+	}
+
+	virtual ofxTLKeyframe* allocate(){
+		if(freeKeys.empty()){
+			//each new block doubles the capacity so that the block count stays small
+			Block block;
+			block.size = blocks.empty() ? 64 : blocks.back().size*2;
+			block.keys = (KeyType*)::operator new(block.size*sizeof(KeyType));
+			block.live.resize(block.size, false);
+			blocks.push_back(block);
+			for(int i = block.size-1; i >= 0; i--){
+				freeKeys.push_back(block.keys + i);
+			}
+		}
+		KeyType* key = freeKeys.back();
+		freeKeys.pop_back();
+		new (key) KeyType();
+		setLive(key, true);
+		numAllocated++;
+		return key;
+	}
+
+	virtual bool release(ofxTLKeyframe* key){
+		KeyType* typedKey = setLive(key, false);
+		if(typedKey == NULL){
+			return false;
+		}
+		typedKey->~KeyType();
+		freeKeys.push_back(typedKey);
+		numAllocated--;
+		return true;
+	}
+
+	virtual void releaseAll(){
+		freeKeys.clear();
+		for(int b = blocks.size()-1; b >= 0; b--){
+			for(int i = blocks[b].size-1; i >= 0; i--){
+				if(blocks[b].live[i]){
+					blocks[b].keys[i].~KeyType();
+					blocks[b].live[i] = false;
+				}
+				freeKeys.push_back(blocks[b].keys + i);
+			}
+		}
+		numAllocated = 0;
+	}
+
+	virtual int getNumAllocated(){
+		return numAllocated;
+	}
+
+  protected:
+	struct Block {
+		KeyType* keys;
+		int size;
+		vector<bool> live;
+	};
+	vector<Block> blocks;
+	vector<KeyType*> freeKeys;
+	int numAllocated;
+
+	//finds the key by address in our blocks and flags it,
+	//returns NULL if it isn't one of ours or is already in that state
+	KeyType* setLive(ofxTLKeyframe* key, bool live){
+		char* address = (char*)key;
+		for(int b = 0; b < blocks.size(); b++){
+			char* blockStart = (char*)blocks[b].keys;
+			if(address >= blockStart && address < blockStart + blocks[b].size*sizeof(KeyType)){
+				int index = (address - blockStart) / sizeof(KeyType);
+				if(blocks[b].live[index] == live){
+					return NULL;
+				}
+				blocks[b].live[index] = live;
+				return blocks[b].keys + index;
+			}
+		}
+		return NULL;
+	}
+};
+
+//remembers which segment the last sample landed in, so the next sample near it can skip the search.
+//give each consumer its own cursor (drawing, playback, a render thread) so they
+//don't keep invalidating each other's position
+class ofxTLKeyframeCursor {
+  public:
+	ofxTLKeyframeCursor(){
+		reset();
+	}
+	void reset(){
+		keyIndex = 1;
+	}
+	//index of the key that ended the last sampled segment
+	int keyIndex;
+};
+
+//contiguous copy of a track's keys, in the same sorted order as the keyframes vector.
+//once built a store is never changed, edits build and publish a new one, so it doubles as a
+//snapshot that other threads can keep sampling while the track is being edited.
+//times and values are kept in parallel arrays so that searching and sampling walk
+//linear memory instead of chasing one pointer per key across the heap.
+//tracks with custom keyframes subclass this and keep their payloads in typed side arrays
+class ofxTLKeyframeStore {
+  public:
+	ofxTLKeyframeStore();
+	virtual ~ofxTLKeyframeStore(){};
+
+	virtual void clear();
+	virtual void reserve(int numKeys);
+	//appends the key to the end of the arrays, subclasses append their payload too
+	virtual void push(ofxTLKeyframe* key);
+	//called once every key has been pushed, for subclasses that derive data from neighbouring keys.
+	//keys appended while recording get pushed and finished again one at a time
+	virtual void finish(){};
+	int size();
+	//returns the index of the first key at or after sampleTime, always between 1 and size()-1.
+	//sampleTime must lie strictly after the first key and no later than the last one.
+	//checks the cursor's segment and the one after it before falling back to a binary search
+	int findSegmentEnd(unsigned long long sampleTime, ofxTLKeyframeCursor& cursor);
+	//binary searches for the keys with minTime <= time <= maxTime,
+	//they are the indices from startIndex up to but not including endIndex
+	void findKeysInRange(unsigned long long minTime, unsigned long long maxTime, int& startIndex, int& endIndex);
+
+	vector<unsigned long long> times;
+	vector<float> values;
+	//the keys the store was built from. they're still owned and edited by the track,
+	//and can be moved or deleted while a snapshot is held, so sampling never reads them.
+	//only the main thread looks at them, through the track's current store
+	vector<ofxTLKeyframe*> keys;
+	
+	//the track's settings when the store was built. sampling maps values through these
+	//instead of the track's members, so a snapshot can be sampled without touching the track
+	ofRange valueRange;
+	float defaultValue;
+	unsigned long long duration; //samples are clamped to this
+};
+
+//min and max of a track's normalized values across the timeline, kept at halving resolutions like mipmaps.
+//level 0 has the finest buckets and each level above merges pairs from the one below,
+//so drawing at any zoom picks a level instead of resampling the track.
+//edits only mark the buckets they touched as dirty
+class ofxTLPreviewEnvelope {
+  public:
+	ofxTLPreviewEnvelope();
+
+	struct Bucket {
+		float min;
+		float max;
+		//values at the start and end of the bucket, to keep the drawn line's direction
+		float first;
+		float last;
+	};
+
+	//sizes level 0 to cover the duration and marks everything dirty
+	void setup(unsigned long long duration, int numBuckets);
+	unsigned long long getDuration();
+	void invalidateAll();
+	//marks the level 0 buckets overlapping the time span dirty
+	void invalidate(unsigned long long startMillis, unsigned long long endMillis);
+	bool isDirty();
+	//call after refilling level 0 from dirtyStart up to dirtyEnd, merges the span up through the other levels
+	void rebuildLevels();
+
+	//time span an edit touched, collected until the next rebuild when
+	//the keys on either side of it are known
+	void addEditedSpan(unsigned long long startMillis, unsigned long long endMillis);
+	bool hasEditedSpan();
+	void clearEditedSpan();
+	unsigned long long editedStart;
+	unsigned long long editedEnd;
+
+	double getBucketMillis(int level);
+	//the coarsest level with buckets no wider than maxMillis, or -1 if even level 0 is wider
+	int getLevelForMillis(double maxMillis);
+
+	vector< vector<Bucket> > levels;
+	int dirtyStart;
+	int dirtyEnd;
+
+  protected:
+	unsigned long long duration;
+	bool editedSpanSet;
+};
+
+//a track rendered into samples at a fixed rate, built from one key store snapshot.
+//values are in the value range the snapshot was built with
+class ofxTLBakedSamples {
+  public:
+	ofxTLBakedSamples();
+
+	//linear interpolation between the two samples around sampleTime
+	float sampleAtTime(long sampleTime);
+
+	//the store it was baked from, reset under snapshotLock when keys get appended to that store
+	ofPtr<ofxTLKeyframeStore> source;
+	unsigned long long duration;
+	float rate;
+	vector<float> samples;
+};
+
+class ofxTLKeyframes;
+//rebakes a track in the background whenever its keys, value range or the timeline duration change
+class ofxTLKeyframeBaker : public ofThread {
+  public:
+	ofxTLKeyframeBaker();
+	ofxTLKeyframes* track;
+	void threadedFunction();
 };
 
 class ofxTLKeyframes : public ofxTLTrack
@@ -104,6 +347,28 @@ class ofxTLKeyframes : public ofxTLTrack
 	virtual float getValue();
 	virtual float getValueAtPercent(float percent);
 	virtual float getValueAtTimeInMillis(long sampleTime);
+	//samples with your own cursor, use this when reading the track from more than one place
+	virtual float getValueAtTimeInMillis(long sampleTime, ofxTLKeyframeCursor& cursor);
+	//fills out with count values evenly spaced from startMillis to endMillis, both inclusive.
+	//much faster than calling getValueAtTimeInMillis in a loop, the keys are walked once for the whole buffer
+	void sampleRange(unsigned long long startMillis, unsigned long long endMillis, int count, float* out);
+
+	//sampling from other threads:
+	//grab a snapshot on the thread that samples and pass it to the calls below with your own cursor.
+	//the snapshot never changes, edits on the main thread publish a new one, so hold on to it
+	//as long as you like and grab a fresh one whenever you want to see the latest edits
+	ofPtr<ofxTLKeyframeStore> getKeyframeSnapshot();
+	float getValueAtTimeInMillis(ofxTLKeyframeStore& snapshot, long sampleTime, ofxTLKeyframeCursor& cursor);
+	void sampleRange(ofxTLKeyframeStore& snapshot, unsigned long long startMillis, unsigned long long endMillis, int count, float* out);
+
+	//baking renders the track into a buffer at a fixed rate on a background thread,
+	//so getValue and getValueAtTimeInMillis become a lookup and a linear interpolation.
+	//useful for tracks that aren't edited during a show, especially LFOs and curves with expensive easings.
+	//after an edit values come from the keys again until the new buffer is ready
+	void setBakeRate(float samplesPerSecond); //0, the default, turns baking off
+	float getBakeRate();
+	//true if the buffer matches the current keys
+	bool isBaked();
 
 	virtual void setValueRange(ofRange range, float defaultValue = 0);
 	virtual void setValueRangeMin(float min);
@@ -122,6 +387,35 @@ class ofxTLKeyframes : public ofxTLTrack
   protected:
 	virtual ofxTLKeyframe* newKeyframe();
 	vector<ofxTLKeyframe*> keyframes;
+
+	//use this in newKeyframe overrides to get keys from the track's pool
+	template<typename KeyType> KeyType* allocateKeyframe(){
+		if(keyPool == NULL){
+			keyPool = ofPtr<ofxTLKeyframePool>(new ofxTLTypedKeyframePool<KeyType>());
+		}
+		ofxTLTypedKeyframePool<KeyType>* typedPool = dynamic_cast<ofxTLTypedKeyframePool<KeyType>*>(keyPool.get());
+		if(typedPool == NULL){
+			//the pool only holds one type, anything else is allocated normally
+			return new KeyType();
+		}
+		return (KeyType*)typedPool->allocate();
+	}
+	//returns a key to the pool, or deletes it if it didn't come from there
+	void disposeKeyframe(ofxTLKeyframe* key);
+	ofPtr<ofxTLKeyframePool> keyPool;
+
+	//packed copy of keyframes used for sampling, searching and previews
+	//set keyStoreIsDirty whenever keys are added, removed, moved or their payload changes
+	//and it will be rebuilt the next time it's requested
+	ofPtr<ofxTLKeyframeStore> keyStore;
+	bool keyStoreIsDirty;
+	//guards swapping keyStore against other threads taking a snapshot
+	ofMutex snapshotLock;
+	ofxTLKeyframeStore& getKeyStore();
+	//true if keys, value range or the timeline duration changed since keyStore was built
+	bool keyStoreNeedsRebuild();
+	//override to return a store subclass with side arrays for custom keyframe data
+	virtual ofxTLKeyframeStore* newKeyframeStore();
 	
 	//cached previews for fast drawing of large timelines
 	ofPolyline preview;
@@ -129,21 +423,60 @@ class ofxTLKeyframes : public ofxTLTrack
 	
 	virtual void recomputePreviews();
 	bool shouldRecomputePreviews;
+	//min/max values at several zoom levels that recomputePreviews draws from.
+	//moving, adding and deleting keys through the base class only refills the time around them,
+	//any other change that sets shouldRecomputePreviews refills the whole envelope
+	ofxTLPreviewEnvelope previewEnvelope;
+	void updatePreviewEnvelope();
+	//scratch buffer for sampleStoreRange while building previews
+	vector<float> previewSamples;
 	
 	virtual float sampleAtPercent(float percent); //less accurate than millis
     virtual float sampleAtTime(long sampleTime);
+	virtual float sampleAtTime(long sampleTime, ofxTLKeyframeCursor& cursor);
+	float sampleStoreAtTime(ofxTLKeyframeStore& store, long sampleTime, ofxTLKeyframeCursor& cursor);
+	//fills out with samples from the store mapped into the store's value range, see sampleRange.
+	//override to sample custom stores without a virtual call per sample.
+	//the baker calls this from its thread, so like the stored key versions below overrides must only read from the store
+	virtual void sampleStoreRange(ofxTLKeyframeStore& store, unsigned long long startMillis, unsigned long long endMillis, int count, float* out);
 	virtual float interpolateValueForKeys(ofxTLKeyframe* start,ofxTLKeyframe* end, unsigned long long sampleTime);
 	virtual float evaluateKeyframeAtTime(ofxTLKeyframe* key, unsigned long long sampleTime, bool firstKey = false);
+	//versions of the above that read from the packed key store by index, these are what sampling uses.
+	//by default they interpolate the store's values linearly like the versions above.
+	//they may be called with a snapshot from another thread, so overrides must only read from the store,
+	//copy whatever else they need into a store subclass in push() rather than reading the keys
+	virtual float interpolateValueForStoredKeys(ofxTLKeyframeStore& store, int startIndex, int endIndex, unsigned long long sampleTime);
+	virtual float evaluateStoredKeyAtTime(ofxTLKeyframeStore& store, int index, unsigned long long sampleTime, bool firstKey = false);
+	//time of sample i out of count for sampleRange, clamped to the store's duration like sampleAtTime
+	unsigned long long rangeSampleTime(ofxTLKeyframeStore& store, unsigned long long startMillis, unsigned long long endMillis, int count, int i);
 
     ofRange valueRange;
 	float defaultValue;
 	
-	//keep these stored for efficient search through the keyframe array
-	int lastKeyframeIndex;
-	unsigned long long lastSampleTime;
+	//keep this stored for efficient search through the keyframe array
+	ofxTLKeyframeCursor playbackCursor;
+
+	//baking, bakedSamples and bakeRate are changed under snapshotLock like keyStore
+	friend class ofxTLKeyframeBaker;
+	ofxTLKeyframeBaker baker;
+	float bakeRate;
+	ofPtr<ofxTLBakedSamples> bakedSamples;
+	//the baked buffer if it's still up to date, otherwise NULL
+	ofPtr<ofxTLBakedSamples> getCurrentBake();
+	//called from the baker thread, returns false if there was nothing to do.
+	//it only reads the published keyStore and bakeRate, both taken under snapshotLock
+	bool bakeIfNeeded();
+	//joins the baker thread. subclasses that override sampling call this first thing in their
+	//destructor, otherwise the baker could still be running their code while their members go away
+	void stopBaking();
 	
     virtual ofxTLKeyframe* keyframeAtScreenpoint(ofVec2f p);
+	//indices into keyframes of the keys in a time window, use these for hit testing and selection
+	//instead of looping over every key
+	void getKeyIndicesInRange(ofLongRange timeRange, int& startIndex, int& endIndex);
+	void getKeyIndicesNearScreenX(float screenX, float distance, int& startIndex, int& endIndex);
 	bool isKeyframeIsInBounds(ofxTLKeyframe* key);
+	bool isTimeInBounds(unsigned long long time);
 	bool isKeyframeSelected(ofxTLKeyframe* k);
     void selectKeyframe(ofxTLKeyframe* k);
     void deselectKeyframe(ofxTLKeyframe* k);
@@ -155,6 +488,7 @@ class ofxTLKeyframes : public ofxTLTrack
 	//this is called before the keyframe is deleted and removed from the keyframes vector
 	virtual void willDeleteKeyframe(ofxTLKeyframe* keyframe){};
 	
+	//selected keys in time order, kept in step with each key's selected flag
 	vector<ofxTLKeyframe*> selectedKeyframes;
     ofxTLKeyframe* selectedKeyframe;
 	ofxTLKeyframe* hoverKeyframe;
@@ -167,6 +501,12 @@ class ofxTLKeyframes : public ofxTLTrack
 	
 	virtual void setKeyframeTime(ofxTLKeyframe* key, unsigned long long newTime);
 	virtual void updateKeyframeSort();
+	//keys passed to setKeyframeTime since the last sort
+	vector<ofxTLKeyframe*> movedKeyframes;
+	//merges just the moved keys back into the sorted list, returns false if a full sort is needed
+	bool resortMovedKeyframes();
+	//nudges two neighboring keys apart by a millisecond if they landed on the same time
+	void separateKeyframes(int index);
 	virtual void updateStretchOffsets(ofVec2f screenpoint, long grabMillis);
 	virtual void updateDragOffsets(ofVec2f screenpoint, long grabMillis);
 
@@ -34,7 +34,216 @@
 #include "ofxTimeline.h"
 #include "ofxHotKeys.h"
 
+ofxTLLFOStore::ofxTLLFOStore()
+:	useFastEvaluation(false)
+{
+}
+
+void ofxTLLFOStore::clear(){
+	ofxTLKeyframeStore::clear();
+	lfoKeys.clear();
+}
+
+void ofxTLLFOStore::reserve(int numKeys){
+	ofxTLKeyframeStore::reserve(numKeys);
+	lfoKeys.reserve(numKeys);
+}
+
+void ofxTLLFOStore::push(ofxTLKeyframe* key){
+	ofxTLKeyframeStore::push(key);
+	lfoKeys.push_back(*(ofxTLLFOKey*)key);
+}
+
+ofxTLLFOPhaseAccumulator::ofxTLLFOPhaseAccumulator(){
+	setup(0, 0, 0, 0);
+}
+
+void ofxTLLFOPhaseAccumulator::setup(double newTheta0, double newAlpha, double newBeta, double newX){
+	theta0 = newTheta0;
+	alpha = newAlpha;
+	beta = newBeta;
+	numSteps = 0;
+	nextSlot = 0;
+	resync(newX);
+}
+
+void ofxTLLFOPhaseAccumulator::resync(double newX){
+	x = newX;
+	stepsSinceSync = 0;
+	double theta = theta0 + alpha*x + beta*x*x;
+	re = cos(theta);
+	im = sin(theta);
+	for(int i = 0; i < numSteps; i++){
+		double angle = alpha*steps[i] + beta*(2*x*steps[i] + steps[i]*steps[i]);
+		stepRe[i] = cos(angle);
+		stepIm[i] = sin(angle);
+		for(int j = 0; j < numSteps; j++){
+			chirpRe[i][j] = cos(2*beta*steps[i]*steps[j]);
+			chirpIm[i][j] = sin(2*beta*steps[i]*steps[j]);
+		}
+	}
+}
+
+double ofxTLLFOPhaseAccumulator::cosAt(double newX){
+	double step = newX - x;
+	if(step == 0){
+		return re;
+	}
+	
+	int slot = -1;
+	for(int i = 0; i < numSteps; i++){
+		if(steps[i] == step){
+			slot = i;
+		}
+	}
+	if(slot == -1){
+		//remember this step size in place of the oldest one
+		steps[nextSlot] = step;
+		numSteps = MAX(numSteps, nextSlot+1);
+		nextSlot = (nextSlot+1) % 2;
+		resync(newX);
+		return re;
+	}
+	if(stepsSinceSync >= 256){
+		resync(newX);
+		return re;
+	}
+	
+	double rotatedRe = re*stepRe[slot] - im*stepIm[slot];
+	im = re*stepIm[slot] + im*stepRe[slot];
+	re = rotatedRe;
+	if(beta != 0){
+		for(int i = 0; i < numSteps; i++){
+			double stepRotatedRe = stepRe[i]*chirpRe[i][slot] - stepIm[i]*chirpIm[i][slot];
+			stepIm[i] = stepRe[i]*chirpIm[i][slot] + stepIm[i]*chirpRe[i][slot];
+			stepRe[i] = stepRotatedRe;
+		}
+	}
+	x = newX;
+	stepsSinceSync++;
+	return re;
+}
+
+const ofxTLLFONoiseTable& ofxTLLFONoiseTable::get(){
+	static ofxTLLFONoiseTable table;
+	return table;
+}
+
+ofxTLLFONoiseTable::ofxTLLFONoiseTable(){
+	//fixed seed so the noise comes out the same every run
+	unsigned int state = 1;
+	for(int i = 0; i < 256; i++){
+		permutation[i] = i;
+	}
+	for(int i = 255; i > 0; i--){
+		state = state * 1103515245 + 12345;
+		swap(permutation[i], permutation[(state >> 16) % (i+1)]);
+	}
+	for(int i = 0; i < 256; i++){
+		permutation[256+i] = permutation[i];
+		state = state * 1103515245 + 12345;
+		gradients[i] = ((state >> 16) & 0x7fff) / 16383.5f - 1.0f;
+	}
+}
+
+float ofxTLLFONoiseTable::noise(float seed, double x) const{
+	x += seed * 57.0;
+	double cell = floor(x);
+	int index = (long long)cell & 255;
+	float offset = x - cell;
+	float fromStart = gradients[permutation[index]] * offset;
+	float fromEnd = gradients[permutation[index+1]] * (offset - 1);
+	float fade = offset*offset*offset*(offset*(offset*6 - 15) + 10);
+	return ofClamp((fromStart + (fromEnd - fromStart)*fade) * 2, -1, 1);
+}
+
+float ofxTLLFONoiseTable::evaluate(const ofxTLLFOKey& key, unsigned long long sampleTime) const{
+	return ofClamp( (noise(key.seed, (2*PI*key.frequency/(1000*60*10))*(key.phaseShift + sampleTime)) * key.amplitude)*.5+.5 + key.center, 0, 1);
+}
+
+void ofxTLLFOSegmentOscillator::setup(const ofxTLLFOKey* newPrevKey, const ofxTLLFOKey* newNextKey, float newDefaultValue, unsigned long long sampleTime){
+	prevKey = newPrevKey;
+	nextKey = newNextKey;
+	defaultValue = newDefaultValue;
+	if(prevKey == NULL){
+		mode = DEFAULT_VALUE;
+	}
+	else if(nextKey == NULL || (!prevKey->interpolate && !prevKey->expInterpolate)){
+		mode = SINGLE_KEY;
+		setupKey(prevKey, phase, sampleTime);
+	}
+	else if(prevKey->type != nextKey->type){
+		mode = BLEND;
+		setupKey(prevKey, phase, sampleTime);
+		setupKey(nextKey, nextPhase, sampleTime);
+	}
+	else if(prevKey->type == OFXTL_LFO_TYPE_NOISE){
+		mode = NOISE_INTERPOLATED;
+	}
+	else if(!prevKey->expInterpolate){
+		//linear chirp, the phase is quadratic in the time since the previous key
+		mode = CHIRP;
+		double segmentDuration = nextKey->time - prevKey->time;
+		phase.setup(prevKey->phaseShift,
+					2*PI*prevKey->frequency / 60000.0,
+					2*PI*(nextKey->frequency - prevKey->frequency) / (120000.0 * segmentDuration),
+					sampleTime - prevKey->time);
+	}
+	else{
+		mode = EXP_CHIRP;
+		double interval = (double)(nextKey->time - prevKey->time) / 60000.0;
+		expRate = log(nextKey->frequency / prevKey->frequency) / interval;
+	}
+}
+
+void ofxTLLFOSegmentOscillator::setupKey(const ofxTLLFOKey* key, ofxTLLFOPhaseAccumulator& keyPhase, unsigned long long sampleTime){
+	if(key->type == OFXTL_LFO_TYPE_SINE){
+		double frequency = 2*PI*key->frequency / 60000.0;
+		keyPhase.setup(frequency*key->phaseShift, frequency, 0, sampleTime);
+	}
+}
+
+float ofxTLLFOSegmentOscillator::sampleKey(const ofxTLLFOKey* key, ofxTLLFOPhaseAccumulator& keyPhase, unsigned long long sampleTime){
+	if(key->type == OFXTL_LFO_TYPE_SINE){
+		return ofClamp(keyPhase.cosAt(sampleTime)*key->amplitude*.5 + .5 + key->center, 0, 1);
+	}
+	return ofxTLLFONoiseTable::get().evaluate(*key, sampleTime);
+}
+
+float ofxTLLFOSegmentOscillator::sample(unsigned long long sampleTime){
+	switch(mode){
+		case DEFAULT_VALUE:
+			return defaultValue;
+		case SINGLE_KEY:
+			return sampleKey(prevKey, phase, sampleTime);
+		case BLEND:
+			return ofMap(sampleTime, prevKey->time, nextKey->time,
+						 sampleKey(prevKey, phase, sampleTime), sampleKey(nextKey, nextPhase, sampleTime));
+		case CHIRP:{
+			float amplitude = ofMap(sampleTime, prevKey->time, nextKey->time, prevKey->amplitude, nextKey->amplitude);
+			float center = ofMap(sampleTime, prevKey->time, nextKey->time, prevKey->center, nextKey->center);
+			return ofClamp(phase.cosAt(sampleTime - prevKey->time) * amplitude * 0.5 + 0.5 + center, 0, 1.0);
+		}
+		case EXP_CHIRP:{
+			double minutes = (sampleTime - prevKey->time) / 60000.0;
+			double chirpPhase = expRate == 0 ? 2*PI*prevKey->frequency*minutes : 2*PI*prevKey->frequency*(exp(expRate*minutes) - 1)/expRate;
+			return ofClamp(cos(chirpPhase) * 0.5 + 0.5, 0, 1.0);
+		}
+		default:{
+			ofxTLLFOKey interpolatedKey = *prevKey;
+			interpolatedKey.phaseShift = ofMap(sampleTime, prevKey->time, nextKey->time, prevKey->phaseShift, nextKey->phaseShift);
+			interpolatedKey.amplitude = ofMap(sampleTime, prevKey->time, nextKey->time, prevKey->amplitude, nextKey->amplitude);
+			interpolatedKey.center = ofMap(sampleTime, prevKey->time, nextKey->time, prevKey->center, nextKey->center);
+			interpolatedKey.frequency = ofMap(sampleTime, prevKey->time, nextKey->time, prevKey->frequency, nextKey->frequency);
+			return ofxTLLFONoiseTable::get().evaluate(interpolatedKey, sampleTime);
+		}
+	}
+}
+
 ofxTLLFO::ofxTLLFO(){
+	useFastEvaluation = false;
+	//build the noise table up front rather than on whichever thread samples first
+	ofxTLLFONoiseTable::get();
 	drawingLFORect = false;
 	rectWidth = 120;
 	rectHeight = 15;
@@ -44,7 +253,7 @@ ofxTLLFO::ofxTLLFO(){
 }
 
 ofxTLLFO::~ofxTLLFO(){
-	
+	stopBaking();
 }
 
 void ofxTLLFO::drawModalContent(){
@@ -175,15 +384,16 @@ void ofxTLLFO::draw(){
 }
 
 float ofxTLLFO::interpolateValueForKeys(ofxTLKeyframe* start, ofxTLKeyframe* end, unsigned long long sampleTime){
-	ofxTLLFOKey* prevKey = (ofxTLLFOKey*)start;
+	return interpolateLFOKeys((ofxTLLFOKey*)start, (ofxTLLFOKey*)end, sampleTime, useFastEvaluation);
+}
+
+float ofxTLLFO::interpolateLFOKeys(ofxTLLFOKey* prevKey, ofxTLLFOKey* nextKey, unsigned long long sampleTime, bool tableNoise){
 //	prevKey->samplePoint = (1./prevKey->frequency)*(prevKey->phaseShift + prevKey->time + sampleTime );
 	
 	if(!prevKey->interpolate && !prevKey->expInterpolate){
-		return evaluateKeyframeAtTime(prevKey, sampleTime);
+		return evaluateLFOKey(prevKey, sampleTime, tableNoise);
 	}
 	
-	ofxTLLFOKey* nextKey = (ofxTLLFOKey*)end;
-	
 	//parametric interpolation
 	if(prevKey->type == nextKey->type){
 //      float alpha = sin(2*PI*ofMap(sampleTime, start->time,end->time, 0, 1.0));
@@ -191,6 +401,7 @@ float ofxTLLFO::interpolateValueForKeys(ofxTLKeyframe* start, ofxTLKeyframe* end
 		ofxTLLFOKey tempkey;
 		tempkey.time = prevKey->time;
 		tempkey.type = prevKey->type;
+		tempkey.seed = prevKey->seed;
 		
 		tempkey.phaseShift = ofMap(sampleTime, prevKey->time, nextKey->time, prevKey->phaseShift, nextKey->phaseShift);
 		tempkey.amplitude = ofMap(sampleTime, prevKey->time, nextKey->time, prevKey->amplitude, nextKey->amplitude);
@@ -226,27 +437,149 @@ float ofxTLLFO::interpolateValueForKeys(ofxTLKeyframe* start, ofxTLKeyframe* end
             
         }
         else {
-            return evaluateKeyframeAtTime(&tempkey, sampleTime);
+            return evaluateLFOKey(&tempkey, sampleTime, tableNoise);
         }
 	}
 	//value interpolation
 	else{
-		return ofMap(sampleTime, start->time, end->time, evaluateKeyframeAtTime(prevKey, sampleTime), evaluateKeyframeAtTime(nextKey, sampleTime));
+		return ofMap(sampleTime, prevKey->time, nextKey->time, evaluateLFOKey(prevKey, sampleTime, tableNoise), evaluateLFOKey(nextKey, sampleTime, tableNoise));
+	}
+}
+
+float ofxTLLFO::interpolateValueForStoredKeys(ofxTLKeyframeStore& store, int startIndex, int endIndex, unsigned long long sampleTime){
+	ofxTLLFOStore& lfoStore = (ofxTLLFOStore&)store;
+	return interpolateLFOKeys(&lfoStore.lfoKeys[startIndex], &lfoStore.lfoKeys[endIndex], sampleTime, lfoStore.useFastEvaluation);
+}
+
+float ofxTLLFO::evaluateStoredKeyAtTime(ofxTLKeyframeStore& store, int index, unsigned long long sampleTime, bool firstKey){
+	if(firstKey){
+		return ofMap(store.defaultValue, store.valueRange.min, store.valueRange.max, 0, 1.0);
+	}
+	ofxTLLFOStore& lfoStore = (ofxTLLFOStore&)store;
+	return evaluateLFOKey(&lfoStore.lfoKeys[index], sampleTime, lfoStore.useFastEvaluation);
+}
+
+ofxTLKeyframeStore* ofxTLLFO::newKeyframeStore(){
+	//only called on the main thread while building a store, setUseFastEvaluation dirties it
+	ofxTLLFOStore* store = new ofxTLLFOStore();
+	store->useFastEvaluation = useFastEvaluation;
+	return store;
+}
+
+void ofxTLLFO::sampleStoreRange(ofxTLKeyframeStore& keyframeStore, unsigned long long startMillis, unsigned long long endMillis, int count, float* out){
+	ofxTLLFOStore& store = (ofxTLLFOStore&)keyframeStore;
+	if(store.size() == 0){
+		ofxTLKeyframes::sampleStoreRange(keyframeStore, startMillis, endMillis, count, out);
+	}
+	else if(store.useFastEvaluation){
+		sampleStoreRangeFast(store, startMillis, endMillis, count, out);
+	}
+	else{
+		sampleStoreRangeDirect(store, startMillis, endMillis, count, out, false);
+	}
+}
+
+void ofxTLLFO::sampleStoreRangeDirect(ofxTLLFOStore& store, unsigned long long startMillis, unsigned long long endMillis, int count, float* out, bool tableNoise){
+	int numKeys = store.size();
+	//call our own evaluation directly instead of going through the virtual store callbacks per sample
+	ofxTLKeyframeCursor cursor;
+	for(int i = 0; i < count; i++){
+		unsigned long long sampleTime = rangeSampleTime(store, startMillis, endMillis, count, i);
+		float sample;
+		if(sampleTime <= store.times[0]){
+			sample = ofMap(store.defaultValue, store.valueRange.min, store.valueRange.max, 0, 1.0);
+		}
+		else if(sampleTime >= store.times[numKeys-1]){
+			sample = evaluateLFOKey(&store.lfoKeys[numKeys-1], sampleTime, tableNoise);
+		}
+		else{
+			int k = store.findSegmentEnd(sampleTime, cursor);
+			sample = interpolateLFOKeys(&store.lfoKeys[k-1], &store.lfoKeys[k], sampleTime, tableNoise);
+		}
+		out[i] = ofMap(sample, 0.0, 1.0, store.valueRange.min, store.valueRange.max, false);
+	}
+}
+
+void ofxTLLFO::sampleStoreRangeFast(ofxTLLFOStore& store, unsigned long long startMillis, unsigned long long endMillis, int count, float* out){
+	int numKeys = store.size();
+	float normalizedDefault = ofMap(store.defaultValue, store.valueRange.min, store.valueRange.max, 0, 1.0);
+	ofxTLKeyframeCursor cursor;
+	ofxTLLFOSegmentOscillator oscillator;
+	//0 before the first key, numKeys from the last key on, otherwise the index of the key ending the segment
+	int segment = -1;
+	for(int i = 0; i < count; i++){
+		unsigned long long sampleTime = rangeSampleTime(store, startMillis, endMillis, count, i);
+		int sampleSegment;
+		if(sampleTime <= store.times[0]){
+			sampleSegment = 0;
+		}
+		else if(sampleTime >= store.times[numKeys-1]){
+			sampleSegment = numKeys;
+		}
+		else{
+			sampleSegment = store.findSegmentEnd(sampleTime, cursor);
+		}
+		
+		if(sampleSegment != segment){
+			segment = sampleSegment;
+			oscillator.setup(segment > 0 ? &store.lfoKeys[segment-1] : NULL,
+							 segment > 0 && segment < numKeys ? &store.lfoKeys[segment] : NULL,
+							 normalizedDefault, sampleTime);
+		}
+		out[i] = ofMap(oscillator.sample(sampleTime), 0.0, 1.0, store.valueRange.min, store.valueRange.max, false);
+	}
+}
+
+void ofxTLLFO::setUseFastEvaluation(bool fast){
+	if(fast != useFastEvaluation){
+		useFastEvaluation = fast;
+		//noise changes, and baked buffers need to be rebuilt
+		keyStoreIsDirty = true;
+		shouldRecomputePreviews = true;
 	}
 }
 
+bool ofxTLLFO::getUseFastEvaluation(){
+	return useFastEvaluation;
+}
+
+float ofxTLLFO::getFastEvaluationError(unsigned long long startMillis, unsigned long long endMillis, int count){
+	ofxTLLFOStore& store = (ofxTLLFOStore&)getKeyStore();
+	if(store.size() == 0 || count <= 0){
+		return 0;
+	}
+	//compare with noise coming from the same table in both, so only the accumulators are measured
+	vector<float> fast(count);
+	vector<float> direct(count);
+	sampleStoreRangeFast(store, startMillis, endMillis, count, &fast[0]);
+	sampleStoreRangeDirect(store, startMillis, endMillis, count, &direct[0], true);
+	
+	float maxError = 0;
+	float range = store.valueRange.max - store.valueRange.min;
+	for(int i = 0; i < count; i++){
+		maxError = MAX(maxError, fabs(fast[i] - direct[i]) / (range == 0 ? 1 : fabs(range)));
+	}
+	return maxError;
+}
+
 //the beating heart
 float ofxTLLFO::evaluateKeyframeAtTime(ofxTLKeyframe* key, unsigned long long sampleTime, bool firstKey){
     if(firstKey){
         return ofMap(defaultValue, valueRange.min, valueRange.max, 0, 1.0);
     }
-	ofxTLLFOKey* lfo = (ofxTLLFOKey*)key;
+	return evaluateLFOKey((ofxTLLFOKey*)key, sampleTime, useFastEvaluation);
+}
+
+float ofxTLLFO::evaluateLFOKey(ofxTLLFOKey* lfo, unsigned long long sampleTime, bool tableNoise){
 	if(lfo->type == OFXTL_LFO_TYPE_SINE){
         // when no interpolation needed.
         return ofClamp(( cos( (2.0f*PI * lfo->frequency) * (sampleTime + lfo->phaseShift) / (1000.0f*60.0f) )*lfo->amplitude)*.5 + .5 + lfo->center, 0, 1);
         
 	}
 	else {
+		if(tableNoise){
+			return ofxTLLFONoiseTable::get().evaluate(*lfo, sampleTime);
+		}
 		return ofClamp( (ofSignedNoise(lfo->seed, (2*PI*lfo->frequency/(1000*60*10))*(lfo->phaseShift + sampleTime)) * lfo->amplitude)*.5+.5 + lfo->center, 0, 1);
 	}
 }
@@ -331,6 +664,7 @@ void ofxTLLFO::mouseDragged(ofMouseEventArgs& args, long millis){
 		if(mouseDownRect != NULL && editingParam != NULL){
 			float delta = (args.x-editingClickX)*editingSensitivity;
 			*editingParam = ofClamp(editingStartValue + delta, editingRange.min, editingRange.max);
+			keyStoreIsDirty = true;
 			shouldRecomputePreviews = true;
 			draggedValue = true;
 			timeline->flagUserChangedValue();
@@ -348,6 +682,7 @@ void ofxTLLFO::mouseReleased(ofMouseEventArgs& args, long millis){
 			if(mouseDownRect == &sineTypeRect){
 				if( lfokey->type != OFXTL_LFO_TYPE_SINE){
 					lfokey->type = OFXTL_LFO_TYPE_SINE;
+					keyStoreIsDirty = true;
 					shouldRecomputePreviews = true;
 					timeline->flagTrackModified(this);
 				}
@@ -355,6 +690,7 @@ void ofxTLLFO::mouseReleased(ofMouseEventArgs& args, long millis){
 			else if(mouseDownRect == &noiseTypeRect){
 				if( lfokey->type != OFXTL_LFO_TYPE_NOISE){
 					lfokey->type = OFXTL_LFO_TYPE_NOISE;
+					keyStoreIsDirty = true;
 					shouldRecomputePreviews = true;
 					timeline->flagTrackModified(this);
 				}
@@ -368,12 +704,14 @@ void ofxTLLFO::mouseReleased(ofMouseEventArgs& args, long millis){
 			else if(mouseDownRect == &interpolateRect){
 				lfokey->interpolate = !lfokey->interpolate;
                 if (lfokey->interpolate) lfokey->expInterpolate = false;
+				keyStoreIsDirty = true;
 				shouldRecomputePreviews = true;
 				timeline->flagTrackModified(this);
 			}
 			else if(mouseDownRect == &expInterpolateRect){
 				lfokey->expInterpolate = !lfokey->expInterpolate;
                 if (lfokey->expInterpolate) lfokey->interpolate = false;
+				keyStoreIsDirty = true;
 				shouldRecomputePreviews = true;
 				timeline->flagTrackModified(this);
 			}
@@ -404,7 +742,7 @@ string ofxTLLFO::getTrackType(){
 
 ofxTLKeyframe* ofxTLLFO::newKeyframe(){
 	//return our type of keyframe, stored in the parent class
-	ofxTLLFOKey* newKey = new ofxTLLFOKey();
+	ofxTLLFOKey* newKey = allocateKeyframe<ofxTLLFOKey>();
 	newKey->type = OFXTL_LFO_TYPE_SINE;
 	newKey->phaseShift = 0; //in millis
     newKey->phaseMatch = false;
@@ -484,16 +822,18 @@ void ofxTLLFO::selectedKeySecondaryClick(ofMouseEventArgs& args){
 }
 
 void ofxTLLFO::regionSelected(ofLongRange timeRange, ofRange valueRange){
-    for(int i = 0; i < keyframes.size(); i++){
-    	if(timeRange.contains( keyframes[i]->time )){
-            selectKeyframe(keyframes[i]);
-        }
+	int startIndex, endIndex;
+	getKeyIndicesInRange(timeRange, startIndex, endIndex);
+    for(int i = startIndex; i < endIndex; i++){
+		selectKeyframe(keyframes[i]);
 	}
 }
 
 ofxTLKeyframe* ofxTLLFO::keyframeAtScreenpoint(ofVec2f p){
     if(bounds.inside(p.x, p.y)){
-        for(int i = 0; i < keyframes.size(); i++){
+		int startIndex, endIndex;
+		getKeyIndicesNearScreenX(p.x, 5, startIndex, endIndex);
+        for(int i = startIndex; i < endIndex; i++){
             float offset = p.x - timeline->millisToScreenX(keyframes[i]->time);
             if (abs(offset) < 5) {
                 return keyframes[i];
@@ -58,6 +58,97 @@ class ofxTLLFOKey : public ofxTLKeyframe {
     bool expInterpolate;
 };
 
+//copies of each key's oscillator settings packed beside the times and values of the store
+class ofxTLLFOStore : public ofxTLKeyframeStore {
+  public:
+	ofxTLLFOStore();
+	virtual void clear();
+	virtual void reserve(int numKeys);
+	virtual void push(ofxTLKeyframe* key);
+
+	vector<ofxTLLFOKey> lfoKeys;
+	//the track's fast evaluation setting when the store was built, so sampling it never reads the track
+	bool useFastEvaluation;
+};
+
+//walks cos(theta0 + alpha*x + beta*x*x) forward over increasing x by rotating a phasor
+//instead of calling cos for every sample. beta is only nonzero for chirps.
+//rotations are cached for up to two step sizes, which covers evenly spaced samples rounded
+//to whole milliseconds. any other step, and every so often to stop drift, recomputes the phase exactly
+class ofxTLLFOPhaseAccumulator {
+  public:
+	ofxTLLFOPhaseAccumulator();
+	void setup(double theta0, double alpha, double beta, double x);
+	//cosine of the phase at x, which must not be before the last x
+	double cosAt(double x);
+
+  protected:
+	void resync(double x);
+	double theta0;
+	double alpha;
+	double beta;
+	double x;
+	double re;
+	double im;
+	int stepsSinceSync;
+	int numSteps;
+	int nextSlot;
+	double steps[2];
+	double stepRe[2];
+	double stepIm[2];
+	//for chirps, rotates step i's rotation to account for x moving by step j
+	double chirpRe[2][2];
+	double chirpIm[2][2];
+};
+
+//1d gradient noise from a permutation and gradient table built once with a fixed seed,
+//used instead of ofSignedNoise when fast evaluation is on. a key's seed offsets where it reads along the noise
+class ofxTLLFONoiseTable {
+  public:
+	static const ofxTLLFONoiseTable& get();
+	//-1 to 1, like ofSignedNoise
+	float noise(float seed, double x) const;
+	//the noise oscillator for a key, normalized like ofxTLLFO::evaluateKeyframeAtTime
+	float evaluate(const ofxTLLFOKey& key, unsigned long long sampleTime) const;
+
+  private:
+	ofxTLLFONoiseTable();
+	int permutation[512];
+	float gradients[256];
+};
+
+//evaluates the stretch of an LFO track between two keys for increasing sample times,
+//giving the same values as ofxTLLFO's evaluateKeyframeAtTime and interpolateValueForKeys
+class ofxTLLFOSegmentOscillator {
+  public:
+	//prevKey is NULL before the first key and nextKey is NULL from the last key on.
+	//defaultValue is normalized
+	void setup(const ofxTLLFOKey* prevKey, const ofxTLLFOKey* nextKey, float defaultValue, unsigned long long sampleTime);
+	//normalized value
+	float sample(unsigned long long sampleTime);
+
+  protected:
+	enum Mode {
+		DEFAULT_VALUE,
+		SINGLE_KEY,
+		CHIRP,
+		EXP_CHIRP,
+		NOISE_INTERPOLATED,
+		BLEND
+	};
+	void setupKey(const ofxTLLFOKey* key, ofxTLLFOPhaseAccumulator& keyPhase, unsigned long long sampleTime);
+	float sampleKey(const ofxTLLFOKey* key, ofxTLLFOPhaseAccumulator& keyPhase, unsigned long long sampleTime);
+
+	Mode mode;
+	const ofxTLLFOKey* prevKey;
+	const ofxTLLFOKey* nextKey;
+	float defaultValue;
+	ofxTLLFOPhaseAccumulator phase;
+	ofxTLLFOPhaseAccumulator nextPhase;
+	//log of the frequency ratio per minute for exponential chirps
+	double expRate;
+};
+
 //Just a simple useless random color keyframer
 //to show how to create a custom keyframer
 class ofxTLLFO : public ofxTLKeyframes {
@@ -90,10 +181,34 @@ class ofxTLLFO : public ofxTLKeyframes {
 	//return a custom name for this keyframe
 	virtual string getTrackType();
 
+	//fast evaluation samples ranges, which drive previews and baking, with phase accumulators instead
+	//of calling cos on every sample, and uses a precomputed gradient table for noise keys everywhere.
+	//sine and chirp output matches the regular math closely, noise looks similar but isn't the same.
+	//off by default
+	void setUseFastEvaluation(bool fast);
+	bool getUseFastEvaluation();
+	//largest difference, normalized, between sampling the range with the phase accumulators
+	//and sampling it one value at a time, for checking the fast path against the regular math
+	float getFastEvaluationError(unsigned long long startMillis, unsigned long long endMillis, int count);
+
   protected:
+	//evaluates the oscillators straight from the packed key store
+	virtual void sampleStoreRange(ofxTLKeyframeStore& store, unsigned long long startMillis, unsigned long long endMillis, int count, float* out);
+	//tableNoise picks the noise table over ofSignedNoise for noise keys
+	void sampleStoreRangeDirect(ofxTLLFOStore& store, unsigned long long startMillis, unsigned long long endMillis, int count, float* out, bool tableNoise);
+	void sampleStoreRangeFast(ofxTLLFOStore& store, unsigned long long startMillis, unsigned long long endMillis, int count, float* out);
+	//main thread only, sampling goes by the copy in the store
+	bool useFastEvaluation;
+
 	
 	virtual float interpolateValueForKeys(ofxTLKeyframe* start,ofxTLKeyframe* end, unsigned long long sampleTime);
 	virtual float evaluateKeyframeAtTime(ofxTLKeyframe* key, unsigned long long sampleTime, bool firstKey = false);
+	//the math behind the two above with the noise source passed in, for sampling stores
+	float interpolateLFOKeys(ofxTLLFOKey* prevKey, ofxTLLFOKey* nextKey, unsigned long long sampleTime, bool tableNoise);
+	float evaluateLFOKey(ofxTLLFOKey* lfo, unsigned long long sampleTime, bool tableNoise);
+	virtual float interpolateValueForStoredKeys(ofxTLKeyframeStore& store, int startIndex, int endIndex, unsigned long long sampleTime);
+	virtual float evaluateStoredKeyAtTime(ofxTLKeyframeStore& store, int index, unsigned long long sampleTime, bool firstKey = false);
+	virtual ofxTLKeyframeStore* newKeyframeStore();
 
 	
 	virtual ofxTLKeyframe* keyframeAtScreenpoint(ofVec2f p);
@@ -34,8 +34,66 @@
 #include "ofxTimeline.h"
 #include "ofxHotKeys.h"
 
+bool switchstartsort(ofxTLSwitch* a, ofxTLSwitch* b){
+	return a->timeRange.min < b->timeRange.min;
+}
+
+bool switchedgesort(const ofxTLSwitchIndex::Edge& a, const ofxTLSwitchIndex::Edge& b){
+	return a.time < b.time;
+}
+
+void ofxTLSwitchIndex::build(vector<ofxTLKeyframe*>& keyframes){
+	switches.resize(keyframes.size());
+	for(int i = 0; i < keyframes.size(); i++){
+		switches[i] = (ofxTLSwitch*)keyframes[i];
+	}
+	//keyframes are sorted by time but edge drags move timeRange.min before the next sort
+	stable_sort(switches.begin(), switches.end(), switchstartsort);
+	
+	starts.resize(switches.size());
+	latestEnds.resize(switches.size());
+	edges.resize(switches.size()*2);
+	for(int i = 0; i < switches.size(); i++){
+		starts[i] = switches[i]->timeRange.min;
+		latestEnds[i] = i == 0 ? switches[i]->timeRange.max : MAX(latestEnds[i-1], switches[i]->timeRange.max);
+		edges[i*2].time = switches[i]->timeRange.min;
+		edges[i*2].key = switches[i];
+		edges[i*2+1].time = switches[i]->timeRange.max;
+		edges[i*2+1].key = switches[i];
+	}
+	stable_sort(edges.begin(), edges.end(), switchedgesort);
+}
+
+ofxTLSwitch* ofxTLSwitchIndex::findSwitchAt(long millis){
+	//nothing before the first switch whose running end reaches millis can contain it,
+	//and nothing starting after millis can either
+	int first = lower_bound(latestEnds.begin(), latestEnds.end(), millis) - latestEnds.begin();
+	int last = upper_bound(starts.begin(), starts.end(), millis) - starts.begin();
+	for(int i = first; i < last; i++){
+		if(switches[i]->timeRange.contains(millis)){
+			return switches[i];
+		}
+	}
+	return NULL;
+}
+
+int ofxTLSwitchIndex::findEdge(long millis, int cursor){
+	//playing forward usually leaves us where the last update did
+	if(cursor >= 0 && cursor <= edges.size() &&
+	   (cursor == 0 || edges[cursor-1].time < millis) &&
+	   (cursor == edges.size() || edges[cursor].time >= millis))
+	{
+		return cursor;
+	}
+	Edge edge;
+	edge.time = millis;
+	return lower_bound(edges.begin(), edges.end(), edge, switchedgesort) - edges.begin();
+}
+
 ofxTLSwitches::ofxTLSwitches(){
 	placingSwitch = NULL;
+	switchIndexIsDirty = true;
+	edgeCursor = 0;
     lastTimelinePoint = 0;
     enteringText = false;
 	clickedTextField = NULL;
@@ -47,30 +105,31 @@ ofxTLSwitches::~ofxTLSwitches(){
 
 void ofxTLSwitches::update(){
     long thisTimelinePoint = currentTrackTime();
-    for(int i = 0; i < keyframes.size(); i++){
-        ofxTLSwitch* switchKey = (ofxTLSwitch*)keyframes[i];
-        
-        // switch turns on
-        if(timeline->getInOutRangeMillis().contains(switchKey->time) &&
-           lastTimelinePoint <= switchKey->time &&
-           thisTimelinePoint >= switchKey->time &&
-           thisTimelinePoint != lastTimelinePoint)
-        {
-            switchStateChanged(keyframes[i]);
-        }
-        
-        // switch turns off
-        if(timeline->getInOutRangeMillis().contains(switchKey->timeRange.max) &&
-           lastTimelinePoint <= switchKey->timeRange.max &&
-           thisTimelinePoint >= switchKey->timeRange.max &&
-           thisTimelinePoint != lastTimelinePoint)
-        {
-            switchStateChanged(keyframes[i]);
-        }
-    }
+	ofxTLSwitchIndex& index = getSwitchIndex();
+	//switches turn on or off at every edge crossed moving forward since the last update
+	edgeCursor = index.findEdge(lastTimelinePoint, edgeCursor);
+	if(thisTimelinePoint > lastTimelinePoint){
+		ofLongRange inOutRange = timeline->getInOutRangeMillis();
+		int edge = edgeCursor;
+		while(edge < index.edges.size() && index.edges[edge].time <= thisTimelinePoint){
+			if(inOutRange.contains(index.edges[edge].time)){
+				switchStateChanged(index.edges[edge].key);
+			}
+			edge++;
+		}
+	}
     lastTimelinePoint = thisTimelinePoint;
 }
 
+ofxTLSwitchIndex& ofxTLSwitches::getSwitchIndex(){
+	if(switchIndexIsDirty){
+		switchIndex.build(keyframes);
+		switchIndexIsDirty = false;
+		edgeCursor = 0;
+	}
+	return switchIndex;
+}
+
 void ofxTLSwitches::switchStateChanged(ofxTLKeyframe* key){
     ofxTLSwitchEventArgs args;
     args.sender = timeline;
@@ -192,16 +251,7 @@ void ofxTLSwitches::draw(){
 }
 
 bool ofxTLSwitches::isOnAtMillis(long millis){
-    for(int i = 0; i < keyframes.size(); i++){
-        ofxTLSwitch* switchKey = (ofxTLSwitch*)keyframes[i];
-        if(switchKey->timeRange.min > millis){
-            break;
-        }
-        if(switchKey->timeRange.contains(millis)){
-            return true;
-        }
-    }
-    return false;    
+    return getSwitchIndex().findSwitchAt(millis) != NULL;
 }
 
 bool ofxTLSwitches::isOn(){
@@ -214,16 +264,7 @@ bool ofxTLSwitches::isOnAtPercent(float percent){
 }
 
 ofxTLSwitch* ofxTLSwitches::getActiveSwitchAtMillis(long millis){
-    for(int i = 0; i < keyframes.size(); i++){
-        ofxTLSwitch* switchKey = (ofxTLSwitch*)keyframes[i];
-        if(switchKey->timeRange.min > millis){
-            break;
-        }
-        if(switchKey->timeRange.contains(millis)){
-            return switchKey;
-        }
-    }
-    return NULL;
+    return getSwitchIndex().findSwitchAt(millis);
 }
 
 bool ofxTLSwitches::mousePressed(ofMouseEventArgs& args, long millis){
@@ -417,6 +458,7 @@ void ofxTLSwitches::mouseMoved(ofMouseEventArgs& args, long millis){
     endHover = startHover = false;
     if(hover && placingSwitch != NULL){
 		placingSwitch->timeRange.max = millis;
+		switchIndexIsDirty = true;
 		return;
 	}
 	
@@ -463,6 +505,7 @@ void ofxTLSwitches::pasteSent(string pasteboard){
 
 //This is called after dragging or nudging, and let's us make sure
 void ofxTLSwitches::updateTimeRanges(){
+	switchIndexIsDirty = true;
 	
     //the superclass will move the ->time value with the drag
     //so we look at the selected keyframes values and see if their changed
@@ -567,7 +610,7 @@ int ofxTLSwitches::getSelectedItemCount(){
 }
 
 ofxTLKeyframe* ofxTLSwitches::newKeyframe(){
-    ofxTLSwitch* switchKey = new ofxTLSwitch();
+    ofxTLSwitch* switchKey = allocateKeyframe<ofxTLSwitch>();
     switchKey->textField.setFont(timeline->getFont());
 
     //in the case of a click, start at the mouse positiion
@@ -578,6 +621,7 @@ ofxTLKeyframe* ofxTLSwitches::newKeyframe(){
 	
 	//for just placing a switch we'll be able to decide the end position
 	placingSwitch = switchKey;
+	switchIndexIsDirty = true;
 	
     return switchKey;
 }
@@ -598,6 +642,7 @@ void ofxTLSwitches::restoreKeyframe(ofxTLKeyframe* key, ofxXmlSettings& xmlStore
     }
     //this is so freshly restored keys won't have ends selected but click keys will
     switchKey->startSelected = switchKey->endSelected = false;
+	switchIndexIsDirty = true;
 	
 	//a bit of a hack, but if 
 	placingSwitch = NULL;
@@ -612,6 +657,7 @@ void ofxTLSwitches::storeKeyframe(ofxTLKeyframe* key, ofxXmlSettings& xmlStore){
 }
 
 void ofxTLSwitches::willDeleteKeyframe(ofxTLKeyframe* keyframe){
+	switchIndexIsDirty = true;
 	ofxTLSwitch* switchKey = (ofxTLSwitch* )keyframe;
 	if(switchKey->textField.getIsEditing()){
 		timeline->dismissedModalContent();
@@ -50,6 +50,28 @@ class ofxTLSwitch : public ofxTLKeyframe {
     ofRectangle textFieldDisplay;
 };
 
+//switch ranges sorted by start time, so point queries binary search instead of walking every switch,
+//plus every start and end in time order so playback only looks at the edges it crosses
+class ofxTLSwitchIndex {
+  public:
+	void build(vector<ofxTLKeyframe*>& keyframes);
+	//the earliest starting switch that contains millis, or NULL
+	ofxTLSwitch* findSwitchAt(long millis);
+	//index of the first edge at or after millis. checks around cursor before searching
+	int findEdge(long millis, int cursor);
+
+	vector<ofxTLSwitch*> switches;
+	vector<long> starts;
+	//the latest end of switches up to and including each index, never decreases
+	vector<long> latestEnds;
+
+	struct Edge {
+		long time;
+		ofxTLSwitch* key;
+	};
+	vector<Edge> edges;
+};
+
 class ofxTLSwitches : public ofxTLKeyframes {
   public:
 	ofxTLSwitches();
@@ -94,6 +116,14 @@ class ofxTLSwitches : public ofxTLKeyframes {
 	//pushes any edits from keyframes superclass into the switches system
 	virtual void updateTimeRanges();
 	
+	//rebuilt the next time it's used after switchIndexIsDirty is set,
+	//which happens whenever a switch's time range changes
+	ofxTLSwitchIndex& getSwitchIndex();
+	ofxTLSwitchIndex switchIndex;
+	bool switchIndexIsDirty;
+	//first edge at or after lastTimelinePoint
+	int edgeCursor;
+	
     long lastTimelinePoint;
     bool startHover;
     bool endHover;
@@ -93,7 +93,14 @@ ofxTimeline::ofxTimeline()
 	//TODO: should be able to use bitmap font if need be
 	fontPath("GUI/NewMedia Fett.ttf"),
 	fontSize(9),
-	footersHidden(false)
+	footersHidden(false),
+	bangSchedulingEnabled(false),
+	bangSchedulingDispatchesOnUpdate(true),
+	bangSchedulingLookahead(100),
+	bangScheduleGeneration(0),
+	bangsScheduledWhilePlaying(false),
+	lastScheduleMillis(0),
+	scheduleLooped(false)
 {
 }
 
@@ -635,6 +642,11 @@ void ofxTimeline::setCurrentTimecode(string timecodeString){
 
 void ofxTimeline::setCurrentTimeSeconds(float time){
 	currentTime = time;
+	//move the playback clock along with it so a seek sticks while playing
+	if(isPlaying && timeControl == NULL){
+		playbackStartTime = timer.getAppTimeSeconds() - currentTime;
+		playbackStartFrame = ofGetFrameNum() - timecode.frameForSeconds(currentTime);
+	}
 }
 
 void ofxTimeline::setCurrentTimeMillis(unsigned long long millis){
@@ -1458,10 +1470,80 @@ bool ofxTimeline::isDone(){
 	return getPercentComplete() >= inoutRange.max && getLoopType() == OF_LOOP_NONE;   
 }
 
+void ofxTimeline::enableBangScheduling(long lookaheadMillis, bool dispatchOnUpdate){
+	bangSchedulingLookahead = MAX(lookaheadMillis, 0L);
+	bangSchedulingDispatchesOnUpdate = dispatchOnUpdate;
+	bangSchedulingEnabled = true;
+}
+
+void ofxTimeline::disableBangScheduling(){
+	bangSchedulingEnabled = false;
+}
+
+bool ofxTimeline::getBangSchedulingEnabled(){
+	return bangSchedulingEnabled;
+}
+
+long ofxTimeline::getBangSchedulingLookahead(){
+	return bangSchedulingLookahead;
+}
+
+int ofxTimeline::getBangScheduleGeneration(){
+	return bangScheduleGeneration;
+}
+
+void ofxTimeline::scheduleBang(ofxTLTrack* track, long millis, double appSeconds, const string& flag){
+	ofxTLScheduledBang bang;
+	bang.track = track;
+	bang.millis = millis;
+	bang.appSeconds = appSeconds;
+	bang.generation = bangScheduleGeneration;
+	strncpy(bang.flag, flag.c_str(), sizeof(bang.flag)-1);
+	bang.flag[sizeof(bang.flag)-1] = '\0';
+	stagedBangs.push_back(bang);
+}
+
+bool ofxTimeline::popScheduledBang(ofxTLScheduledBang& bang, double untilAppSeconds){
+	const ofxTLScheduledBang* next;
+	while((next = bangQueue.front()) != NULL){
+		//queued before playback stopped or jumped
+		if(next->generation != bangScheduleGeneration){
+			bangQueue.pop();
+			continue;
+		}
+		if(next->appSeconds > untilAppSeconds){
+			return false;
+		}
+		bang = *next;
+		bangQueue.pop();
+		return true;
+	}
+	return false;
+}
+
+void ofxTimeline::dispatchScheduledBangs(){
+	ofxTLScheduledBang bang;
+	double now = timer.getAppTimeSeconds();
+	while(popScheduledBang(bang, now)){
+		ofxTLBangEventArgs args;
+		args.sender = this;
+		args.track = bang.track;
+		args.currentMillis = bang.millis;
+		args.currentTime = bang.millis/1000.;
+		args.currentPercent = args.currentTime/durationInSeconds;
+		args.currentFrame = timecode.frameForSeconds(args.currentTime);
+		args.flag = bang.flag;
+		ofNotifyEvent(timelineEvents.bangFired, args);
+	}
+}
+
 void ofxTimeline::update(ofEventArgs& updateArgs){
 	if(!isOnThread){
 		updateTime();
 	}
+	if(bangSchedulingEnabled && bangSchedulingDispatchesOnUpdate){
+		dispatchScheduledBangs();
+	}
 }
 
 void ofxTimeline::threadedFunction(){
@@ -1488,10 +1570,38 @@ void ofxTimeline::updateTime(){
 	checkEvents();
 }
 
+static bool scheduledBangIsEarlier(const ofxTLScheduledBang& a, const ofxTLScheduledBang& b){
+	return a.appSeconds < b.appSeconds;
+}
+
 void ofxTimeline::checkEvents(){
+	if(bangSchedulingEnabled){
+		//starting, stopping or jumping back other than by looping drops whatever is still queued
+		bool playing = getIsPlaying();
+		long now = getCurrentTimeMillis();
+		if(playing != bangsScheduledWhilePlaying || (now < lastScheduleMillis && !scheduleLooped)){
+			bangScheduleGeneration = bangScheduleGeneration+1;
+		}
+		bangsScheduledWhilePlaying = playing;
+		lastScheduleMillis = now;
+		scheduleLooped = false;
+	}
+	
 	for(int i = 0; i < pages.size(); i++){
 		pages[i]->update();
 	}
+	
+	if(!stagedBangs.empty()){
+		//each track schedules in order, merge them so the queue is in due order
+		stable_sort(stagedBangs.begin(), stagedBangs.end(), scheduledBangIsEarlier);
+		for(int i = 0; i < stagedBangs.size(); i++){
+			if(!bangQueue.push(stagedBangs[i])){
+				ofLogWarning("ofxTimeline::checkEvents") << "bang queue is full, dropping " << (stagedBangs.size() - i) << " bangs";
+				break;
+			}
+		}
+		stagedBangs.clear();
+	}
 }
 
 void ofxTimeline::checkLoop(){
@@ -1510,6 +1620,7 @@ void ofxTimeline::checkLoop(){
             currentTime = durationInSeconds*inoutRange.min + (currentTime - durationInSeconds*inoutRange.max);
             playbackStartFrame += getDurationInFrames()  * inoutRange.span();
             playbackStartTime  += getDurationInSeconds() * inoutRange.span();
+            scheduleLooped = true;
             ofxTLPlaybackEventArgs args = createPlaybackEvent();
             ofNotifyEvent(events().playbackLooped, args);
         }
@@ -1759,6 +1870,18 @@ float ofxTimeline::getValue(string trackName, int atFrame){
     return getValue(trackName, timecode.secondsForFrame(atFrame));
 }
 
+void ofxTimeline::getValues(string trackName, float startTime, float endTime, int count, float* out){
+	if(!hasTrack(trackName)){
+		ofLogError("ofxTimeline -- Couldn't find track " + trackName);
+		for(int i = 0; i < count; i++){
+			out[i] = 0.0;
+		}
+		return;
+	}
+	ofxTLKeyframes* keyframes = (ofxTLKeyframes*)trackNameToPage[trackName]->getTrack(trackName);
+	keyframes->sampleRange(MAX(startTime, 0)*1000, MAX(endTime, 0)*1000, count, out);
+}
+
 bool ofxTimeline::hasTrack(string trackName){
 	return trackNameToPage.find(trackName) != trackNameToPage.end();
 }
@@ -136,6 +136,22 @@ class ofxTimeline : ofThread {
 	virtual ofLoopType getLoopType();
     bool isDone(); //returns true if percentComplete == 1.0 and loop type is none
 
+	//bang scheduling: while playing, bangs and flags up to lookaheadMillis ahead of the playhead
+	//are queued stamped with the getTimer() time they're due, rather than fired as update() passes them.
+	//the queue has to be drained from exactly one thread, by default the main thread dispatches
+	//bangFired events on update. to drain from an audio callback instead pass false and call
+	//popScheduledBang() with the timer time at the end of each buffer, placing each bang at
+	//(bang.appSeconds - bufferStartTime)*sampleRate
+	virtual void enableBangScheduling(long lookaheadMillis = 100, bool dispatchOnUpdate = true);
+	virtual void disableBangScheduling();
+	virtual bool getBangSchedulingEnabled();
+	virtual long getBangSchedulingLookahead();
+	virtual bool popScheduledBang(ofxTLScheduledBang& bang, double untilAppSeconds);
+	virtual void dispatchScheduledBangs();
+	//called by tracks from update()
+	virtual void scheduleBang(ofxTLTrack* track, long millis, double appSeconds, const string& flag);
+	int getBangScheduleGeneration();
+
 	virtual bool toggleShow();    
     virtual void show();
 	virtual void hide();
@@ -348,6 +364,9 @@ class ofxTimeline : ofThread {
 	float getValueAtPercent(string name, float atPercent);
 	float getValue(string name, float atTime);
 	float getValue(string name, int atFrame);
+	//fills out with count values evenly spaced between the two times in seconds, both inclusive.
+	//use this instead of calling getValue in a loop when you need many samples per frame
+	void getValues(string name, float startTime, float endTime, int count, float* out);
 
 	//adding tracks always adds to the current page
     ofxTLLFO* addLFO(string name, ofRange valueRange = ofRange(0,1.0), float defaultValue = 0);
@@ -591,4 +610,16 @@ class ofxTimeline : ofThread {
 	
 	bool isFrameBased;
 	float durationInSeconds;
+	
+	bool bangSchedulingEnabled;
+	bool bangSchedulingDispatchesOnUpdate;
+	long bangSchedulingLookahead;
+	ofxTLBangQueue bangQueue;
+	//bangs the tracks scheduled this update, pushed in due order once they've all updated
+	vector<ofxTLScheduledBang> stagedBangs;
+	//bumped to drop everything queued when playback starts, stops or jumps back
+	volatile int bangScheduleGeneration;
+	bool bangsScheduledWhilePlaying;
+	long lastScheduleMillis;
+	bool scheduleLooped;
 };
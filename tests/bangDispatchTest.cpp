@@ -0,0 +1,124 @@
+/**
+ * bang dispatch test
+ * ofxTimeline
+ *
+ * plays 100k bangs through ofxTLBangs::update and checks every one fires once,
+ * in order, on the update whose step (last playhead, this playhead] crossed it.
+ * also seeks backwards and puts bangs exactly on the playhead
+ */
+
+#include "ofMain.h"
+#include "ofxTimeline.h"
+#include "ofxTLBangs.h"
+
+//lets the test set a long duration without calling setup, which needs a window
+class TestTimeline : public ofxTimeline {
+  public:
+	void setDuration(float seconds){
+		durationInSeconds = seconds;
+	}
+};
+
+//remembers the bangs instead of sending events
+class RecordingBangs : public ofxTLBangs {
+  public:
+	vector<unsigned long long> fired;
+	
+	//moves the playhead and runs the bang dispatch like the timeline's update would.
+	//returns where the playhead actually landed, the timeline keeps time in float seconds
+	long step(TestTimeline& timeline, long millis){
+		timeline.setCurrentTimeMillis(millis);
+		update();
+		return timeline.getCurrentTimeMillis();
+	}
+	
+  protected:
+	virtual void bangFired(ofxTLKeyframe* key){
+		fired.push_back(key->time);
+	}
+};
+
+int failures = 0;
+
+void expect(bool condition, string message){
+	if(!condition){
+		ofLogError() << message;
+		failures++;
+	}
+}
+
+int main(){
+	TestTimeline timeline;
+	timeline.setAutosave(false);
+	timeline.enableUndo(false);
+	timeline.setDuration(1100);
+	
+	//100k bangs ten milliseconds apart, added in order like a recording
+	RecordingBangs bangs;
+	bangs.setTimeline(&timeline);
+	int numBangs = 100000;
+	vector<unsigned long long> keyTimes;
+	for(int i = 0; i < numBangs; i++){
+		keyTimes.push_back(i*10 + 5);
+		bangs.addKeyframeAtMillis(0, keyTimes.back());
+	}
+	
+	//play straight through at an odd step so the playhead lands all over the gaps,
+	//checking each update only fires what it crossed
+	long last = bangs.step(timeline, 0);
+	bool inOrder = true;
+	bool inStep = true;
+	for(long millis = 7; millis < 1010000; millis += 7){
+		int before = bangs.fired.size();
+		long now = bangs.step(timeline, millis);
+		for(int i = before; i < bangs.fired.size(); i++){
+			inStep &= bangs.fired[i] > last && bangs.fired[i] <= now;
+			inOrder &= i == 0 || bangs.fired[i] > bangs.fired[i-1];
+		}
+		last = now;
+	}
+	expect(bangs.fired.size() == numBangs, "playback fired " + ofToString(bangs.fired.size()) + " of " + ofToString(numBangs) + " bangs");
+	expect(bangs.fired == keyTimes, "playback didn't fire the bangs in key order");
+	expect(inOrder, "playback fired bangs out of order");
+	expect(inStep, "playback fired a bang outside the step that crossed it");
+	
+	//seeking back fires nothing, then playing on from there fires each bang from the seek point on once more
+	bangs.fired.clear();
+	long seekedTo = bangs.step(timeline, 400003);
+	expect(bangs.fired.size() == 0, "seeking backwards fired " + ofToString(bangs.fired.size()) + " bangs");
+	long playedTo = seekedTo;
+	for(long millis = 400003; millis <= 500000; millis += 13){
+		playedTo = bangs.step(timeline, millis);
+	}
+	vector<unsigned long long> replayed(lower_bound(keyTimes.begin(), keyTimes.end(), (unsigned long long)seekedTo),
+										upper_bound(keyTimes.begin(), keyTimes.end(), (unsigned long long)playedTo));
+	expect(bangs.fired == replayed, "after seeking back " + ofToString(bangs.fired.size()) + " bangs fired, expected " + ofToString(replayed.size()));
+	
+	//bangs right on the playhead. one reached by playing fires on that update and not on the next,
+	//one the playhead was seeked onto fires when playback moves off it
+	RecordingBangs boundary;
+	boundary.setTimeline(&timeline);
+	boundary.step(timeline, 1000);
+	long onBang = boundary.step(timeline, 2000);
+	boundary.addKeyframeAtMillis(0, onBang);
+	boundary.step(timeline, 1000);
+	boundary.fired.clear();
+	boundary.step(timeline, 1500);
+	boundary.step(timeline, 2000);
+	expect(boundary.fired.size() == 1, "a bang the playhead stopped on fired " + ofToString(boundary.fired.size()) + " times, expected once");
+	boundary.step(timeline, 2500);
+	expect(boundary.fired.size() == 1, "a bang the playhead stopped on fired again on the next update");
+	
+	boundary.fired.clear();
+	boundary.step(timeline, 3000);
+	boundary.step(timeline, 2000);
+	boundary.step(timeline, 2500);
+	expect(boundary.fired.size() == 1, "a bang the playhead was seeked onto fired " + ofToString(boundary.fired.size()) + " times, expected once");
+	
+	if(failures > 0){
+		ofLogError() << failures << " checks failed";
+		return 1;
+	}
+	ofLogNotice() << "all bangs fired once and in order";
+	return 0;
+}
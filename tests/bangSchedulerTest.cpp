@@ -0,0 +1,256 @@
+/**
+ * bang scheduler test
+ * ofxTimeline
+ *
+ * pushes a million bangs through ofxTLBangQueue from a second thread, across
+ * the ring and the unsigned index wrapping, and checks they come out in order
+ * with none lost or repeated. then plays a looping timeline with bang scheduling
+ * on and checks every pass is queued once, a loop ahead where it has to be,
+ * and that stopping and seeking back drop what was already queued
+ */
+
+#include <climits>
+#include <cfloat>
+#include "ofMain.h"
+#include "ofxTimeline.h"
+#include "ofxTLBangs.h"
+
+//starts its indices just short of where unsigned int wraps around
+class WrappingQueue : public ofxTLBangQueue {
+  public:
+	WrappingQueue(int capacity, unsigned int startIndex) : ofxTLBangQueue(capacity){
+		writeIndex = startIndex;
+		readIndex = startIndex;
+	}
+};
+
+//pushes numbered bangs from its own thread, waiting whenever the queue is full
+class BangProducer : public ofThread {
+  public:
+	ofxTLBangQueue* queue;
+	int numBangs;
+	volatile bool done;
+
+	BangProducer(ofxTLBangQueue* _queue, int _numBangs){
+		queue = _queue;
+		numBangs = _numBangs;
+		done = false;
+	}
+
+	void threadedFunction(){
+		ofxTLScheduledBang bang;
+		bang.track = NULL;
+		bang.generation = 0;
+		for(int i = 0; i < numBangs; i++){
+			bang.millis = i;
+			bang.appSeconds = i;
+			sprintf(bang.flag, "bang %d", i);
+			//give the consumer a go when there's only one core
+			while(!queue->push(bang)){
+				ofSleepMillis(0);
+			}
+		}
+		done = true;
+	}
+};
+
+//plays without setup, which needs a window, and updates one track where the pages would
+class TestTimeline : public ofxTimeline {
+  public:
+	ofxTLTrack* scheduledTrack;
+
+	TestTimeline(){
+		scheduledTrack = NULL;
+	}
+
+	void setDuration(float seconds){
+		durationInSeconds = seconds;
+	}
+
+	void start(){
+		isEnabled = true;
+		play();
+	}
+
+	//stop() needs the ticker from setup
+	void halt(){
+		isPlaying = false;
+	}
+
+	double getPlaybackStartTime(){
+		return playbackStartTime;
+	}
+
+	void update(){
+		updateTime();
+	}
+
+  protected:
+	//the track isn't on a page, so run the scheduling on either side of its update
+	//like checkEvents does around the pages: drop the queue first, queue what it staged after
+	virtual void checkEvents(){
+		ofxTimeline::checkEvents();
+		if(scheduledTrack != NULL){
+			scheduledTrack->update();
+		}
+		ofxTimeline::checkEvents();
+	}
+};
+
+int failures = 0;
+
+void expect(bool condition, string message){
+	if(!condition){
+		ofLogError() << message;
+		failures++;
+	}
+}
+
+//pops everything due by untilAppSeconds, returning the timeline times
+vector<long> popBangs(TestTimeline& timeline, double untilAppSeconds){
+	vector<long> popped;
+	ofxTLScheduledBang bang;
+	while(timeline.popScheduledBang(bang, untilAppSeconds)){
+		popped.push_back(bang.millis);
+	}
+	return popped;
+}
+
+int main(){
+	//a small ring so the producer laps it constantly, once from zero and
+	//once from just short of where the indices wrap back to zero
+	int numBangs = 1000000;
+	unsigned int startIndices[] = { 0, UINT_MAX - 1000 };
+	for(int s = 0; s < 2; s++){
+		WrappingQueue queue(64, startIndices[s]);
+		BangProducer producer(&queue, numBangs);
+		unsigned long long queueStart = ofGetElapsedTimeMicros();
+		producer.startThread();
+
+		int popped = 0;
+		int misplaced = 0;
+		long expected = 0;
+		while(!producer.done || !queue.empty()){
+			const ofxTLScheduledBang* bang = queue.front();
+			if(bang == NULL){
+				ofSleepMillis(0);
+				continue;
+			}
+			string flag = "bang " + ofToString(expected);
+			if(bang->millis != expected || bang->appSeconds != expected || flag != bang->flag){
+				if(misplaced == 0){
+					ofLogError() << "expected bang " << expected << ", got " << bang->millis << " flagged '" << bang->flag << "'";
+				}
+				misplaced++;
+			}
+			expected = bang->millis + 1;
+			queue.pop();
+			popped++;
+		}
+		producer.waitForThread(true);
+		unsigned long long queueMicros = ofGetElapsedTimeMicros() - queueStart;
+
+		expect(misplaced == 0, ofToString(misplaced) + " bangs came out of the queue out of order, lost or repeated, starting from index " + ofToString(startIndices[s]));
+		expect(popped == numBangs, "popped " + ofToString(popped) + " of " + ofToString(numBangs) + " bangs starting from index " + ofToString(startIndices[s]));
+		ofLogNotice() << "passed " << numBangs << " bangs between threads in " << queueMicros / 1000 << "ms";
+	}
+
+	//a 200ms loop with a bang every 10ms, scheduled 30ms ahead
+	TestTimeline timeline;
+	timeline.setAutosave(false);
+	timeline.enableUndo(false);
+	timeline.setDuration(.2);
+	timeline.setLoopType(OF_LOOP_NORMAL);
+	timeline.enableBangScheduling(30, false);
+	long span = timeline.getDurationInMilliseconds();
+
+	ofxTLBangs bangs;
+	bangs.setTimeline(&timeline);
+	timeline.scheduledTrack = &bangs;
+	vector<long> keyTimes;
+	for(long millis = 1; millis < span; millis += 10){
+		keyTimes.push_back(millis);
+		bangs.addKeyframeAtMillis(0, millis);
+	}
+
+	//play five passes, updating about as often as frames come and popping bangs as
+	//they come due like an audio callback would. most loops land the playhead past
+	//the first bang, which was only ever queued on the pass before.
+	//works out from when each bang was due which pass it was queued for
+	timeline.start();
+	double playbackStart = timeline.getPlaybackStartTime();
+	long playedMillis = 5*span;
+	vector<long> fired;
+	int offTime = 0;
+	double now = timeline.getTimer().getAppTimeSeconds();
+	while(now < playbackStart + playedMillis/1000.){
+		timeline.update();
+		now = timeline.getTimer().getAppTimeSeconds();
+		ofxTLScheduledBang bang;
+		while(timeline.popScheduledBang(bang, now)){
+			double dueMillis = (bang.appSeconds - playbackStart)*1000;
+			long pass = floor((dueMillis - bang.millis) / span + .5);
+			long passMillis = pass*span + bang.millis;
+			if(fabs(dueMillis - passMillis) > 3 || bang.track != &bangs){
+				offTime++;
+			}
+			fired.push_back(passMillis);
+		}
+		ofSleepMillis(8);
+	}
+
+	//every bang of every pass up to a little before the end, once and in order
+	vector<long> expectedFired;
+	for(long pass = 0; pass < 6; pass++){
+		for(int i = 0; i < keyTimes.size(); i++){
+			expectedFired.push_back(pass*span + keyTimes[i]);
+		}
+	}
+	int mismatched = 0;
+	for(int i = 0; i < fired.size(); i++){
+		if(i >= expectedFired.size() || fired[i] != expectedFired[i]){
+			if(mismatched == 0){
+				ofLogError() << "bang " << i << " was due at " << fired[i] << "ms into playback, expected " << (i < expectedFired.size() ? expectedFired[i] : -1) << "ms";
+			}
+			mismatched++;
+		}
+	}
+	int dueBeforeEnd = 0;
+	while(dueBeforeEnd < expectedFired.size() && expectedFired[dueBeforeEnd] < playedMillis - 5){
+		dueBeforeEnd++;
+	}
+	expect(mismatched == 0, ofToString(mismatched) + " bangs across the loop came out of order, repeated or on the wrong pass");
+	expect(fired.size() >= dueBeforeEnd, "only " + ofToString(fired.size()) + " of the " + ofToString(dueBeforeEnd) + " bangs due in five passes were popped");
+	expect(offTime == 0, ofToString(offTime) + " bangs were due more than 3ms away from their pass");
+	ofLogNotice() << "popped " << fired.size() << " scheduled bangs over five passes of the loop";
+
+	//stopping drops the lookahead that was still queued
+	timeline.halt();
+	timeline.update();
+	vector<long> afterStop = popBangs(timeline, DBL_MAX);
+	expect(afterStop.empty(), ofToString(afterStop.size()) + " bangs queued before stopping were still popped after it");
+
+	//seeking back drops the queue too, and scheduling carries on from the new playhead
+	timeline.start();
+	timeline.setCurrentTimeMillis(150);
+	timeline.update();
+	int generation = timeline.getBangScheduleGeneration();
+	timeline.setCurrentTimeMillis(50);
+	timeline.update();
+	long seekMillis = timeline.getCurrentTimeMillis();
+	expect(timeline.getBangScheduleGeneration() != generation, "seeking back didn't start a new schedule generation");
+	vector<long> afterSeek = popBangs(timeline, DBL_MAX);
+	bool seekInWindow = !afterSeek.empty() && afterSeek[0] == 51;
+	for(int i = 0; i < afterSeek.size(); i++){
+		seekInWindow &= afterSeek[i] >= 50 && afterSeek[i] <= seekMillis + 30 && (i == 0 || afterSeek[i] == afterSeek[i-1] + 10);
+	}
+	expect(seekInWindow, "after seeking back to 50ms the queue held " + ofToString(afterSeek.size()) + " bangs starting at " + (afterSeek.empty() ? string("none") : ofToString(afterSeek[0]) + "ms"));
+	timeline.halt();
+
+	if(failures > 0){
+		ofLogError() << failures << " checks failed";
+		return 1;
+	}
+	ofLogNotice() << "the bang queue and scheduler kept every bang in order";
+	return 0;
+}
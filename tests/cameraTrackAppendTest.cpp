@@ -0,0 +1,141 @@
+/**
+ * camera track append test
+ * ofxTimeline
+ *
+ * appends keys to a camera track one at a time, the way recording with the
+ * camera does, sampling the track after each one. checks the store's segments
+ * keep up with its keys and that the path matches a store built from scratch
+ */
+
+#include "ofMain.h"
+#include "ofxTimeline.h"
+#include "ofxTLCameraTrack.h"
+
+//lets the test set a long duration without calling setup, which needs a window
+class TestTimeline : public ofxTimeline {
+  public:
+	void setDuration(float seconds){
+		durationInSeconds = seconds;
+	}
+};
+
+//new keys take the pose the test hands it instead of reading a camera
+class PosedCameraTrack : public ofxTLCameraTrack {
+  public:
+	ofVec3f nextPosition;
+	ofQuaternion nextOrientation;
+	
+	ofxTLCameraStore& store(){
+		return (ofxTLCameraStore&)getKeyStore();
+	}
+	
+	bool storeIsCurrent(){
+		return !keyStoreNeedsRebuild();
+	}
+	
+	void rebuildStore(){
+		keyStoreIsDirty = true;
+		getKeyStore();
+	}
+	
+	ofxTLCameraFrame frameAt(unsigned long long millis){
+		ofxTLCameraFrame frame;
+		setCameraFrameToTime(&frame, millis);
+		return frame;
+	}
+	
+  protected:
+	virtual ofxTLKeyframe* newKeyframe(){
+		ofxTLCameraFrame* key = (ofxTLCameraFrame*)ofxTLCameraTrack::newKeyframe();
+		key->position = nextPosition;
+		key->orientation = nextOrientation;
+		return key;
+	}
+};
+
+int failures = 0;
+
+void expect(bool condition, string message){
+	if(!condition){
+		ofLogError() << message;
+		failures++;
+	}
+}
+
+int main(){
+	TestTimeline timeline;
+	timeline.setAutosave(false);
+	timeline.enableUndo(false);
+	timeline.setDuration(200);
+	
+	PosedCameraTrack track;
+	track.setTimeline(&timeline);
+	
+	//a spiral with the camera turning along it, a key every 100ms
+	int numKeys = 1000;
+	bool appendedInPlace = true;
+	for(int i = 0; i < numKeys; i++){
+		track.nextPosition.set(cos(i*.1)*100, i, sin(i*.1)*100);
+		track.nextOrientation.makeRotate(i*3, ofVec3f(0,1,0));
+		bool wasCurrent = i > 0 && track.storeIsCurrent();
+		track.addKeyframeAtMillis(i*100);
+		//after the first build every key should go on the end of the live store
+		appendedInPlace &= i < 2 || (wasCurrent && track.storeIsCurrent());
+		
+		ofxTLCameraStore& store = track.store();
+		expect(store.size() == i+1, "store has " + ofToString(store.size()) + " keys after adding " + ofToString(i+1));
+		expect(store.segments.size() == MAX(store.size()-1, 0), "store has " + ofToString(store.segments.size()) + " segments for " + ofToString(store.size()) + " keys");
+		if(failures > 0){
+			break;
+		}
+		//sample the old last segment and the new one like playback passing over them
+		if(i > 1){
+			track.frameAt(i*100 - 150);
+		}
+		if(i > 0){
+			track.frameAt(i*100 - 50);
+		}
+	}
+	expect(appendedInPlace, "appending in order rebuilt the store instead of pushing onto it");
+	if(failures > 0){
+		ofLogError() << failures << " checks failed";
+		return 1;
+	}
+	
+	//the store grown one key at a time has to sample the same as one built in one go
+	int numSamples = 20000;
+	vector<ofVec3f> appendedPositions(numSamples), rebuiltPositions(numSamples);
+	vector<ofQuaternion> appendedOrientations(numSamples), rebuiltOrientations(numSamples);
+	vector<ofxTLCameraFrame> appendedFrames, rebuiltFrames;
+	unsigned long long lastKey = (numKeys-1)*100;
+	track.samplePath(0, lastKey, numSamples, &appendedPositions[0], &appendedOrientations[0]);
+	for(int i = 0; i < numKeys-1; i++){
+		appendedFrames.push_back(track.frameAt(i*100 + 37));
+	}
+	
+	track.rebuildStore();
+	track.samplePath(0, lastKey, numSamples, &rebuiltPositions[0], &rebuiltOrientations[0]);
+	for(int i = 0; i < numKeys-1; i++){
+		rebuiltFrames.push_back(track.frameAt(i*100 + 37));
+	}
+	
+	int mismatches = 0;
+	for(int i = 0; i < numSamples; i++){
+		if(appendedPositions[i] != rebuiltPositions[i] || !(appendedOrientations[i] == rebuiltOrientations[i])){
+			mismatches++;
+		}
+	}
+	for(int i = 0; i < numKeys-1; i++){
+		if(appendedFrames[i].position != rebuiltFrames[i].position || !(appendedFrames[i].orientation == rebuiltFrames[i].orientation)){
+			mismatches++;
+		}
+	}
+	expect(mismatches == 0, ofToString(mismatches) + " samples differ between the appended and the rebuilt store");
+	
+	if(failures > 0){
+		ofLogError() << failures << " checks failed";
+		return 1;
+	}
+	ofLogNotice() << "appended camera keys sample the same as a rebuilt store";
+	return 0;
+}
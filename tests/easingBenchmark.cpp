@@ -0,0 +1,94 @@
+/**
+ * easing benchmark
+ * ofxTimeline
+ *
+ * times every easing a curves track offers through ofxTween::map, through the
+ * ofxTLEase function ofxTLCurves resolves for each segment, and through the
+ * vectorized kernel where there is one. only the easing math is timed,
+ * the sample times are laid out in advance
+ */
+
+#include "ofMain.h"
+#include "ofxTween.h"
+#include "ofxTLCurves.h"
+#include "ofxTLInterpolationKernels.h"
+
+int main(){
+	const ofxTLEasingRegistry& registry = ofxTLEasingRegistry::get();
+	
+	int count = 1000000;
+	float duration = 1000;
+	float from = -2;
+	float to = 3;
+	vector<float> elapsed(count);
+	for(int i = 0; i < count; i++){
+		elapsed[i] = duration * i / (count-1);
+	}
+	vector<float> mapped(count);
+	vector<float> eased(count);
+	vector<float> batched(count);
+	
+	ofLogNotice() << "nanoseconds per sample, " << count << " samples each. kernels use " << ofxTLInterpolationKernels::getInstructionSet();
+	ofLogNotice() << "easing, type: ofxTween::map / ofxTLEase / kernel";
+	
+	int failures = 0;
+	for(int f = 0; f < registry.easingFunctions.size(); f++){
+		for(int t = 0; t < registry.easingTypes.size(); t++){
+			ofxEasing& easing = *registry.easingFunctions[f]->easing;
+			ofxTween::ofxEasingType type = registry.easingTypes[t]->type;
+			string name = registry.easingFunctions[f]->name + ", " + registry.easingTypes[t]->name;
+			
+			unsigned long long mapStart = ofGetElapsedTimeMicros();
+			for(int i = 0; i < count; i++){
+				mapped[i] = ofxTween::map(elapsed[i], 0, duration, from, to, false, easing, type);
+			}
+			unsigned long long mapMicros = ofGetElapsedTimeMicros() - mapStart;
+			
+			ofxTLEasingFunction ease = ofxTLInterpolationKernels::functionForEasing(&easing, type);
+			if(ease == NULL){
+				ofLogError() << name << " has no ofxTLEase function";
+				failures++;
+				continue;
+			}
+			unsigned long long easeStart = ofGetElapsedTimeMicros();
+			for(int i = 0; i < count; i++){
+				eased[i] = ease(elapsed[i], from, to - from, duration);
+			}
+			unsigned long long easeMicros = ofGetElapsedTimeMicros() - easeStart;
+			
+			//same functions with the same arguments, nothing should differ
+			for(int i = 0; i < count; i++){
+				if(eased[i] != mapped[i]){
+					ofLogError() << name << " ofxTLEase differs at " << elapsed[i] << ": " << eased[i] << ", ofxTween::map " << mapped[i];
+					failures++;
+					break;
+				}
+			}
+			
+			string kernelTime = "-";
+			ofxTLEasingKernel kernel = ofxTLInterpolationKernels::kernelForEasing(&easing, type);
+			if(kernel != OFXTL_KERNEL_NONE){
+				unsigned long long kernelStart = ofGetElapsedTimeMicros();
+				ofxTLInterpolationKernels::interpolate(kernel, &elapsed[0], duration, from, to, count, &batched[0]);
+				unsigned long long kernelMicros = ofGetElapsedTimeMicros() - kernelStart;
+				kernelTime = ofToString(kernelMicros * 1000. / count, 2);
+				//see interpolationKernelsTest.cpp for the tolerance
+				for(int i = 0; i < count; i++){
+					if(fabs(batched[i] - mapped[i]) > 1e-6 * MAX(fabs(from), fabs(to))){
+						ofLogError() << name << " kernel differs at " << elapsed[i] << ": " << batched[i] << ", ofxTween::map " << mapped[i];
+						failures++;
+						break;
+					}
+				}
+			}
+			
+			ofLogNotice() << name << ": " << ofToString(mapMicros * 1000. / count, 2) << " / " << ofToString(easeMicros * 1000. / count, 2) << " / " << kernelTime;
+		}
+	}
+	
+	if(failures > 0){
+		ofLogError() << failures << " easings differ";
+		return 1;
+	}
+	return 0;
+}
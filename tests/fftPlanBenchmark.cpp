@@ -0,0 +1,234 @@
+/**
+ * fft plan benchmark
+ * ofxTimeline
+ *
+ * runs the same frames of a signal through ofFFTAnalyzer_TimelineAdditions and
+ * through the per call getSpectrum / getAverages the sound player used before it,
+ * checks the bins and log averages agree and times both
+ */
+
+#include "ofMain.h"
+#include "ofOpenALSoundPlayer_TimelineAdditions.h"
+
+//the old ofOpenALSoundPlayer_TimelineAdditions spectrum path, fed a signal instead of the play head
+struct PlayerSpectrum {
+	int samplerate;
+	kiss_fftr_cfg fftCfg;
+	vector<float> window;
+	float windowSum;
+	float bandWidth;
+	vector<float> windowedSignal;
+	vector<kiss_fft_cpx> cx_out;
+	vector<float> bins;
+	vector<float> averages;
+	int octaves;
+	int avgPerOctave;
+
+	PlayerSpectrum(int _samplerate){
+		samplerate = _samplerate;
+		fftCfg = 0;
+		octaves = 0;
+		avgPerOctave = 0;
+	}
+
+	~PlayerSpectrum(){
+		if(fftCfg!=0) kiss_fftr_free(fftCfg);
+	}
+
+	void createWindow(int size){
+		if(int(window.size())!=size){
+			windowSum = 0;
+			window.resize(size);
+			bandWidth = (2.0f / size) * (samplerate / 2.0f);
+			for(int i = 0; i < size; i++){
+				window[i] = .54 - .46 * cos((TWO_PI * i) / (size - 1));
+				windowSum += window[i];
+			}
+		}
+	}
+
+	void initFFT(int bands){
+		if(int(bins.size())==bands) return;
+		int signalSize = (bands-1)*2;
+		if(fftCfg!=0) kiss_fftr_free(fftCfg);
+		fftCfg = kiss_fftr_alloc(signalSize, 0, NULL, NULL);
+		cx_out.resize(bands);
+		bins.resize(bands);
+		createWindow(signalSize);
+	}
+
+	void setLogAverages(int minBandwidth, int bandsPerOctave){
+		float nyquist = (float) samplerate / 2.0f;
+		octaves = 1;
+		while ((nyquist /= 2) > minBandwidth){
+			octaves++;
+		}
+		avgPerOctave = bandsPerOctave;
+		averages.resize(octaves * bandsPerOctave);
+	}
+
+	vector<float>& getSpectrum(int bands, const float* signal){
+		initFFT(bands);
+		bins.assign(bins.size(),0);
+		int signalSize = (bands-1)*2;
+		windowedSignal.assign(signal, signal + signalSize);
+
+		float normalizer = 2. / windowSum;
+		for(int i = 0; i < signalSize; i++){
+			windowedSignal[i] *= window[i];
+		}
+		kiss_fftr(fftCfg, &windowedSignal[0], &cx_out[0]);
+		for(int i= 0; i < bands; i++) {
+			bins[i] += sqrtf(cx_out[i].r * cx_out[i].r + cx_out[i].i * cx_out[i].i) * normalizer;
+		}
+		return bins;
+	}
+
+	vector<float>& getAverages(const float* signal){
+		getSpectrum(bins.size(), signal);
+		for (int i = 0; i < octaves; i++){
+			float lowFreq, hiFreq, freqStep;
+			if (i == 0){
+				lowFreq = 0;
+			}
+			else{
+				lowFreq = (samplerate / 2) / powf(2, octaves - i);
+			}
+			hiFreq = (samplerate / 2) / powf(2, octaves - i - 1);
+			freqStep = (hiFreq - lowFreq) / avgPerOctave;
+			float f = lowFreq;
+			for (int j = 0; j < avgPerOctave; j++){
+				averages[j + i * avgPerOctave] = calculateAverage(f, f + freqStep);
+				f += freqStep;
+			}
+		}
+		return averages;
+	}
+
+	float calculateAverage(float lowFreq, float hiFreq){
+		int lowBound = freqToIndex(lowFreq);
+		int hiBound = freqToIndex(hiFreq);
+		float avg = 0;
+		for (int i = lowBound; i <= hiBound; i++) {
+			avg += bins[i];
+		}
+		avg /= (hiBound - lowBound + 1);
+		return avg;
+	}
+
+	int freqToIndex(float freq){
+		if (freq < bandWidth / 2) return 0;
+		if (freq > samplerate / 2 - window.size() / 2) return bins.size() - 1;
+		float fraction = freq / samplerate;
+		return int( floor(window.size() * fraction + .5) );
+	}
+};
+
+//the plan sums the bins once in double precision where the old path summed each
+//average in float, so they only agree to a few float roundings
+bool agrees(float old, float plan, float peak){
+	return fabs(old - plan) <= 1e-5 * MAX(fabs(old), peak * 1e-3);
+}
+
+int main(){
+	//bins, sample rate, min bandwidth, bands per octave.
+	//the first is what ofxTLAudioTrack asks for by default
+	int settings[][4] = {
+		{ 1024, 44100, 88, 20 },
+		{ 512, 48000, 60, 12 },
+		{ 2048, 44100, 22, 3 }
+	};
+
+	int failures = 0;
+	for(int s = 0; s < 3; s++){
+		int bands = settings[s][0];
+		int samplerate = settings[s][1];
+		int minBandwidth = settings[s][2];
+		int bandsPerOctave = settings[s][3];
+
+		PlayerSpectrum player(samplerate);
+		player.initFFT(bands);
+		player.setLogAverages(minBandwidth, bandsPerOctave);
+		ofFFTAnalyzer_TimelineAdditions plan;
+		plan.setup(bands, samplerate, minBandwidth, bandsPerOctave);
+
+		//noise over a couple of tones, analyzed half a frame apart like a track being previewed
+		int signalSize = plan.getSignalSize();
+		int numFrames = 64;
+		int hop = signalSize / 2;
+		vector<float> signal(hop * (numFrames + 1));
+		for(int i = 0; i < signal.size(); i++){
+			signal[i] = ofRandom(-.5, .5) + .3 * sin(i * .07) + .1 * sin(i * 1.3);
+		}
+
+		int iterations = 5000;
+		float checksum = 0;
+		unsigned long long playerStart = ofGetElapsedTimeMicros();
+		for(int i = 0; i < iterations; i++){
+			checksum += player.getAverages(&signal[(i % numFrames) * hop])[0];
+		}
+		unsigned long long playerMicros = ofGetElapsedTimeMicros() - playerStart;
+
+		unsigned long long planStart = ofGetElapsedTimeMicros();
+		for(int i = 0; i < iterations; i++){
+			const float* frame = &signal[(i % numFrames) * hop];
+			float* planSignal = plan.getSignal();
+			for(int j = 0; j < signalSize; j++){
+				planSignal[j] = frame[j];
+			}
+			plan.run();
+			checksum += plan.getAverages()[0];
+		}
+		unsigned long long planMicros = ofGetElapsedTimeMicros() - planStart;
+
+		int mismatches = 0;
+		if(player.averages.size() != plan.getNumAverages() || player.bins.size() != plan.getNumBins()){
+			ofLogError() << bands << " bins: player has " << player.bins.size() << " bins and " << player.averages.size()
+						 << " averages, plan has " << plan.getNumBins() << " and " << plan.getNumAverages();
+			failures++;
+			continue;
+		}
+		for(int f = 0; f < numFrames; f++){
+			const float* frame = &signal[f * hop];
+			vector<float>& oldAverages = player.getAverages(frame);
+			float* planSignal = plan.getSignal();
+			for(int j = 0; j < signalSize; j++){
+				planSignal[j] = frame[j];
+			}
+			plan.run();
+
+			float peak = 0;
+			for(int i = 0; i < bands; i++){
+				peak = MAX(peak, player.bins[i]);
+			}
+			for(int i = 0; i < bands; i++){
+				if(!agrees(player.bins[i], plan.getBins()[i], peak)){
+					if(mismatches == 0){
+						ofLogError() << bands << " bins, frame " << f << " bin " << i << ": " << player.bins[i] << " from the player, " << plan.getBins()[i] << " from the plan";
+					}
+					mismatches++;
+				}
+			}
+			for(int i = 0; i < oldAverages.size(); i++){
+				if(!agrees(oldAverages[i], plan.getAverages()[i], peak)){
+					if(mismatches == 0){
+						ofLogError() << bands << " bins, frame " << f << " average " << i << ": " << oldAverages[i] << " from the player, " << plan.getAverages()[i] << " from the plan";
+					}
+					mismatches++;
+				}
+			}
+		}
+		failures += mismatches;
+
+		ofLogNotice() << bands << " bins at " << samplerate << "hz, " << plan.getNumAverages() << " averages: "
+					  << "player " << double(playerMicros) / iterations << "us, "
+					  << "plan " << double(planMicros) / iterations << "us per frame"
+					  << " (checksum " << checksum << ")";
+	}
+
+	if(failures > 0){
+		ofLogError() << failures << " bins or averages differ";
+		return 1;
+	}
+	return 0;
+}
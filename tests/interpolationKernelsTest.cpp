@@ -0,0 +1,182 @@
+/**
+ * interpolation kernels test
+ * ofxTimeline
+ *
+ * checks the scalar and vectorized kernels in ofxTLInterpolationKernels
+ * against ofMap and ofxTween::map for every kernel, across a handful of segments
+ */
+
+#include "ofMain.h"
+#include "ofxTween.h"
+#include "ofxTLInterpolationKernels.h"
+
+//largest difference allowed from ofxTween::map, as a fraction of the
+//bigger of the segment's two values. the kernels divide once and multiply
+//where ofxTween divides per sample, so the last couple of bits can differ
+const float tolerance = 1e-6;
+
+struct Segment {
+	float duration;
+	float from;
+	float to;
+};
+
+//user easings derived from the stock ones, with a different curve
+class SteeperQuad : public ofxEasingQuad {
+  public:
+	float easeIn(float t, float b, float c, float d){
+		return ofxEasingQuad::easeIn(t, b, c, d) * .5 + ofxEasingCubic().easeIn(t, b, c, d) * .5;
+	}
+};
+
+class SteeperCubic : public ofxEasingCubic {
+  public:
+	float easeOut(float t, float b, float c, float d){
+		return ofxEasingCubic::easeOut(t, b, c, d) * .5 + ofxEasingQuart().easeOut(t, b, c, d) * .5;
+	}
+};
+
+int failures = 0;
+
+void check(string name, const float* elapsed, const float* expected, const float* out, int count, Segment segment){
+	float allowed = tolerance * MAX(MAX(fabs(segment.from), fabs(segment.to)), 1.0f);
+	for(int i = 0; i < count; i++){
+		if(fabs(out[i] - expected[i]) > allowed){
+			ofLogError() << name << " at " << elapsed[i] << " of " << segment.duration << "ms from " << segment.from << " to " << segment.to
+						 << ": " << out[i] << ", expected " << expected[i];
+			failures++;
+			return;
+		}
+	}
+}
+
+int main(){
+	ofxEasingLinear linear;
+	ofxEasingQuad quad;
+	ofxEasingCubic cubic;
+	
+	struct {
+		ofxTLEasingKernel kernel;
+		string name;
+		ofxEasing* easing;
+		ofxTween::ofxEasingType type;
+	} kernels[] = {
+		{ OFXTL_KERNEL_LINEAR, "linear", &linear, ofxTween::easeIn },
+		{ OFXTL_KERNEL_QUAD_IN, "quadratic in", &quad, ofxTween::easeIn },
+		{ OFXTL_KERNEL_QUAD_OUT, "quadratic out", &quad, ofxTween::easeOut },
+		{ OFXTL_KERNEL_CUBIC_IN, "cubic in", &cubic, ofxTween::easeIn },
+		{ OFXTL_KERNEL_CUBIC_OUT, "cubic out", &cubic, ofxTween::easeOut },
+		{ OFXTL_KERNEL_CUBIC_IN_OUT, "cubic in out", &cubic, ofxTween::easeInOut },
+	};
+	int numKernels = sizeof(kernels) / sizeof(kernels[0]);
+	
+	Segment segments[] = {
+		{ 1000, 0, 1 },
+		{ 1000, 1, 0 },
+		{ 1, -.5, .5 },
+		{ 33, 0.25, 0.2501 },
+		{ 250000, -2000, 350 },
+		{ 86400000, 0, 1 },
+	};
+	int numSegments = sizeof(segments) / sizeof(segments[0]);
+	
+	ofLogNotice() << "vectorized kernels use " << ofxTLInterpolationKernels::getInstructionSet();
+	
+	for(int k = 0; k < numKernels; k++){
+		//the kernel lookup has to agree with the easing the kernel replaces
+		if(ofxTLInterpolationKernels::kernelForEasing(kernels[k].easing, kernels[k].type) != kernels[k].kernel){
+			ofLogError() << "kernelForEasing doesn't pick the " << kernels[k].name << " kernel";
+			failures++;
+		}
+		
+		for(int s = 0; s < numSegments; s++){
+			Segment segment = segments[s];
+			//both ends of the segment in the four wide part and in the scalar remainder,
+			//the midpoint where in out easings switch halves, and everything in between.
+			//103 samples leaves three over after the last group of four
+			vector<float> elapsed;
+			elapsed.push_back(0);
+			elapsed.push_back(segment.duration);
+			elapsed.push_back(segment.duration / 2);
+			for(int i = 0; i < 97; i++){
+				elapsed.push_back(segment.duration * i / 96);
+			}
+			elapsed.push_back(segment.duration / 2);
+			elapsed.push_back(segment.duration);
+			elapsed.push_back(0);
+			int count = elapsed.size();
+			
+			vector<float> expected(count);
+			for(int i = 0; i < count; i++){
+				expected[i] = ofxTween::map(elapsed[i], 0, segment.duration, segment.from, segment.to, false, *kernels[k].easing, kernels[k].type);
+			}
+			
+			vector<float> out(count);
+			ofxTLInterpolationKernels::interpolateScalar(kernels[k].kernel, &elapsed[0], segment.duration, segment.from, segment.to, count, &out[0]);
+			check(kernels[k].name + " scalar", &elapsed[0], &expected[0], &out[0], count, segment);
+			
+			ofxTLInterpolationKernels::interpolateVectorized(kernels[k].kernel, &elapsed[0], segment.duration, segment.from, segment.to, count, &out[0]);
+			check(kernels[k].name + " vectorized", &elapsed[0], &expected[0], &out[0], count, segment);
+			
+			//writing over the input like ofxTLCurves does
+			vector<float> inPlace = elapsed;
+			ofxTLInterpolationKernels::interpolate(kernels[k].kernel, &inPlace[0], segment.duration, segment.from, segment.to, count, &inPlace[0]);
+			check(kernels[k].name + " in place", &elapsed[0], &expected[0], &inPlace[0], count, segment);
+			
+			if(kernels[k].kernel == OFXTL_KERNEL_LINEAR){
+				for(int i = 0; i < count; i++){
+					expected[i] = ofMap(elapsed[i], 0, segment.duration, segment.from, segment.to);
+				}
+				check("linear against ofMap", &elapsed[0], &expected[0], &out[0], count, segment);
+			}
+		}
+	}
+	
+	//every other easing has to fall back to ofxTween::map
+	ofxEasingSine sine;
+	ofxEasingCirc circ;
+	ofxEasingQuart quart;
+	ofxEasingQuint quint;
+	ofxEasingExpo expo;
+	ofxEasingBack back;
+	ofxEasingBounce bounce;
+	ofxEasingElastic elastic;
+	ofxEasing* others[] = { &sine, &circ, &quart, &quint, &expo, &back, &bounce, &elastic };
+	ofxTween::ofxEasingType types[] = { ofxTween::easeIn, ofxTween::easeOut, ofxTween::easeInOut };
+	for(int e = 0; e < 8; e++){
+		for(int t = 0; t < 3; t++){
+			if(ofxTLInterpolationKernels::kernelForEasing(others[e], types[t]) != OFXTL_KERNEL_NONE){
+				ofLogError() << typeid(*others[e]).name() << " type " << t << " was given a kernel";
+				failures++;
+			}
+		}
+	}
+	if(ofxTLInterpolationKernels::kernelForEasing(&quad, ofxTween::easeInOut) != OFXTL_KERNEL_NONE){
+		ofLogError() << "quadratic in out was given a kernel";
+		failures++;
+	}
+	
+	//a subclass of a stock easing has its own curve, so it gets neither the stock kernel nor the stock function
+	SteeperQuad steeperQuad;
+	SteeperCubic steeperCubic;
+	ofxEasing* derived[] = { &steeperQuad, &steeperCubic };
+	for(int e = 0; e < 2; e++){
+		for(int t = 0; t < 3; t++){
+			if(ofxTLInterpolationKernels::kernelForEasing(derived[e], types[t]) != OFXTL_KERNEL_NONE){
+				ofLogError() << "a subclass of a stock easing, type " << t << ", was given the stock kernel";
+				failures++;
+			}
+			if(ofxTLInterpolationKernels::functionForEasing(derived[e], types[t]) != NULL){
+				ofLogError() << "a subclass of a stock easing, type " << t << ", was given the stock function";
+				failures++;
+			}
+		}
+	}
+	
+	if(failures > 0){
+		ofLogError() << failures << " checks failed";
+		return 1;
+	}
+	ofLogNotice() << "all kernels match within " << tolerance;
+	return 0;
+}
@@ -0,0 +1,148 @@
+/**
+ * keyframe bake test
+ * ofxTimeline
+ *
+ * checks sample times and baked samples keep millisecond and sample precision
+ * on long timelines, where float positions would run out of bits, and that
+ * recording into a baked track appends to its store instead of rebuilding it per key
+ */
+
+#include "ofMain.h"
+#include "ofxTimeline.h"
+#include "ofxTLKeyframes.h"
+
+//lets the test set a long duration without calling setup, which needs a window
+class TestTimeline : public ofxTimeline {
+  public:
+	void setDuration(float seconds){
+		durationInSeconds = seconds;
+	}
+};
+
+//exposes the time sampleRange uses for each sample
+class TestKeyframes : public ofxTLKeyframes {
+  public:
+	unsigned long long sampleTime(unsigned long long startMillis, unsigned long long endMillis, int count, int i){
+		return rangeSampleTime(getKeyStore(), startMillis, endMillis, count, i);
+	}
+};
+
+//counts how many times the track builds a whole new store
+class CountingKeyframes : public ofxTLKeyframes {
+  public:
+	int storesBuilt;
+	
+	CountingKeyframes(){
+		storesBuilt = 0;
+	}
+	
+  protected:
+	virtual ofxTLKeyframeStore* newKeyframeStore(){
+		storesBuilt++;
+		return ofxTLKeyframes::newKeyframeStore();
+	}
+};
+
+int failures = 0;
+
+void expect(bool condition, string message){
+	if(!condition){
+		ofLogError() << message;
+		failures++;
+	}
+}
+
+int main(){
+	TestTimeline timeline;
+	timeline.setAutosave(false);
+	timeline.enableUndo(false);
+
+	//six hours is past 2^24 milliseconds, where a float only holds every other millisecond
+	timeline.setDuration(6*60*60);
+	TestKeyframes track;
+	track.setTimeline(&timeline);
+	track.addKeyframeAtMillis(0, 0);
+	unsigned long long start = 20000001;
+	int count = 11;
+	for(int i = 0; i < count; i++){
+		unsigned long long sampleTime = track.sampleTime(start, start + count - 1, count, i);
+		expect(sampleTime == start + i, "sample " + ofToString(i) + " from " + ofToString(start) + "ms landed on " + ofToString(sampleTime) + "ms");
+	}
+	unsigned long long duration = timeline.getDurationInMilliseconds();
+	unsigned long long clamped = track.sampleTime(duration - 1, duration + 9, count, count-1);
+	expect(clamped == duration, "a sample past the end landed on " + ofToString(clamped) + "ms instead of the duration");
+
+	//ten minutes at 44.1khz is past 2^24 samples, with most milliseconds between two of them.
+	//alternating samples make the interpolated value the distance from the nearest even one
+	ofxTLBakedSamples bake;
+	bake.duration = 10*60*1000;
+	bake.rate = 44100;
+	bake.samples.resize(bake.duration * double(bake.rate) / 1000 + 1);
+	for(int i = 0; i < bake.samples.size(); i++){
+		bake.samples[i] = i % 2;
+	}
+	int misses = 0;
+	for(long millis = bake.duration - 1000; millis <= bake.duration; millis++){
+		double position = millis * 44.1;
+		int index = MIN(int(position), (int)bake.samples.size()-2);
+		double alpha = position - index;
+		float expected = index % 2 == 0 ? alpha : 1 - alpha;
+		float sampled = bake.sampleAtTime(millis);
+		if(fabs(sampled - expected) > 1e-4){
+			if(misses == 0){
+				ofLogError() << "baked sample at " << millis << "ms gave " << sampled << ", expected " << expected;
+			}
+			misses++;
+		}
+	}
+	expect(misses == 0, ofToString(misses) + " baked samples in the last second of a long bake were off");
+
+	//record into a baked track, sampling it after every key like playback would.
+	//the baker keeps rebaking behind it, and only a key landing mid bake should need a new store
+	timeline.setDuration(10*60);
+	CountingKeyframes recorded;
+	recorded.setTimeline(&timeline);
+	recorded.setBakeRate(50);
+	recorded.addKeyframeAtMillis(ofRandom(1.0), 0);
+	recorded.getValueAtTimeInMillis(0);
+	for(int wait = 0; wait < 500 && !recorded.isBaked(); wait++){
+		ofSleepMillis(10);
+	}
+	int numKeys = 2000;
+	unsigned long long recordStart = ofGetElapsedTimeMicros();
+	for(int i = 1; i < numKeys; i++){
+		recorded.addKeyframeAtMillis(ofRandom(1.0), i * 20);
+		recorded.getValueAtTimeInMillis(i * 20);
+		//frames going by, long enough for the baker to catch up between most keys
+		ofSleepMillis(1);
+	}
+	unsigned long long recordMicros = ofGetElapsedTimeMicros() - recordStart;
+	expect(recorded.storesBuilt < numKeys / 20, "recording " + ofToString(numKeys) + " keys into a baked track built " + ofToString(recorded.storesBuilt) + " stores");
+	expect(recorded.getKeyframeSnapshot()->size() == numKeys, "the recorded store has " + ofToString(recorded.getKeyframeSnapshot()->size()) + " keys, expected " + ofToString(numKeys));
+	ofLogNotice() << "recorded " << numKeys << " baked keys in " << recordMicros / 1000 << "ms, building " << recorded.storesBuilt << " stores";
+	
+	//once the baker catches up the bake has every key in it
+	for(int wait = 0; wait < 500 && !recorded.isBaked(); wait++){
+		ofSleepMillis(10);
+	}
+	expect(recorded.isBaked(), "the recorded track never finished baking");
+	ofPtr<ofxTLKeyframeStore> snapshot = recorded.getKeyframeSnapshot();
+	ofxTLKeyframeCursor cursor;
+	int unbaked = 0;
+	for(int i = 0; i < numKeys; i++){
+		float baked = recorded.getValueAtTimeInMillis(i * 20);
+		float stored = recorded.getValueAtTimeInMillis(*snapshot, i * 20, cursor);
+		if(fabs(baked - stored) > 1e-5){
+			unbaked++;
+		}
+	}
+	expect(unbaked == 0, ofToString(unbaked) + " recorded keys are missing from the bake");
+	recorded.setBakeRate(0);
+	
+	if(failures > 0){
+		ofLogError() << failures << " checks failed";
+		return 1;
+	}
+	ofLogNotice() << "long timelines sample and bake at full precision";
+	return 0;
+}
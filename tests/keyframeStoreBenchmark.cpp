@@ -0,0 +1,158 @@
+/**
+ * keyframe store benchmark
+ * ofxTimeline
+ *
+ * samples a large ofxTLKeyframes track through getValueAtTimeInMillis and sampleRange,
+ * which go through its packed ofxTLKeyframeStore, and through the pointer walk
+ * it used before, checks they agree and times both
+ */
+
+#include "ofMain.h"
+#include "ofxTimeline.h"
+#include "ofxTLKeyframes.h"
+
+//the search from the old ofxTLKeyframes::sampleAtTime, one pointer per key
+struct PointerWalk {
+	vector<ofxTLKeyframe*>* keyframes;
+	int lastKeyframeIndex;
+	long lastSampleTime;
+	
+	float sample(long sampleTime){
+		vector<ofxTLKeyframe*>& keys = *keyframes;
+		if(sampleTime <= keys[0]->time){
+			return keys[0]->value;
+		}
+		if(sampleTime >= keys[keys.size()-1]->time){
+			return keys[keys.size()-1]->value;
+		}
+		int startKeyframeIndex = 1;
+		if(sampleTime >= lastSampleTime){
+			startKeyframeIndex = lastKeyframeIndex;
+		}
+		for(int i = startKeyframeIndex; i < keys.size(); i++){
+			if(keys[i]->time >= sampleTime){
+				lastKeyframeIndex = i;
+				lastSampleTime = sampleTime;
+				return ofMap(sampleTime, keys[i-1]->time, keys[i]->time, keys[i-1]->value, keys[i]->value);
+			}
+		}
+		return 0;
+	}
+};
+
+//lets the test set a long duration without calling setup, which needs a window
+class TestTimeline : public ofxTimeline {
+  public:
+	void setDuration(float seconds){
+		durationInSeconds = seconds;
+	}
+};
+
+//hands out the track's own keys for the old walk to run over
+class TestKeyframes : public ofxTLKeyframes {
+  public:
+	vector<ofxTLKeyframe*>& getKeyframes(){
+		return keyframes;
+	}
+};
+
+int main(){
+	int numKeys = 100000;
+	unsigned long long duration = numKeys * 40;
+	
+	TestTimeline timeline;
+	timeline.setAutosave(false);
+	timeline.enableUndo(false);
+	timeline.setDuration(duration / 1000.0);
+	
+	//recorded in order with a little jitter, the way a session would lay them down
+	TestKeyframes track;
+	track.setTimeline(&timeline);
+	for(int i = 0; i < numKeys; i++){
+		track.addKeyframeAtMillis(ofRandom(1.0), i * 40 + (i % 7));
+	}
+	vector<ofxTLKeyframe*>& keyframes = track.getKeyframes();
+	
+	//playback steps through the track a few milliseconds at a time,
+	//scrubbing jumps anywhere
+	vector<long> playbackTimes;
+	for(long t = 0; t <= duration; t += 3){
+		playbackTimes.push_back(t);
+	}
+	vector<long> scrubTimes;
+	for(int i = 0; i < 2000; i++){
+		scrubTimes.push_back(ofRandom(duration));
+	}
+	vector<long>* patterns[] = { &playbackTimes, &scrubTimes };
+	string patternNames[] = { "playback", "scrubbing" };
+	
+	int failures = 0;
+	for(int p = 0; p < 2; p++){
+		vector<long>& times = *patterns[p];
+		vector<float> walked(times.size());
+		vector<float> sampled(times.size());
+		
+		PointerWalk walk;
+		walk.keyframes = &keyframes;
+		walk.lastKeyframeIndex = 1;
+		walk.lastSampleTime = 0;
+		unsigned long long walkStart = ofGetElapsedTimeMicros();
+		for(int i = 0; i < times.size(); i++){
+			walked[i] = walk.sample(times[i]);
+		}
+		unsigned long long walkMicros = ofGetElapsedTimeMicros() - walkStart;
+		
+		ofxTLKeyframeCursor cursor;
+		unsigned long long trackStart = ofGetElapsedTimeMicros();
+		for(int i = 0; i < times.size(); i++){
+			sampled[i] = track.getValueAtTimeInMillis(times[i], cursor);
+		}
+		unsigned long long trackMicros = ofGetElapsedTimeMicros() - trackStart;
+		
+		int mismatches = 0;
+		for(int i = 0; i < times.size(); i++){
+			if(walked[i] != sampled[i]){
+				if(mismatches == 0){
+					ofLogError() << patternNames[p] << " differs at " << times[i] << "ms: " << walked[i] << " walked, " << sampled[i] << " from the track";
+				}
+				mismatches++;
+			}
+		}
+		failures += mismatches;
+		
+		ofLogNotice() << patternNames[p] << ", " << times.size() << " samples of " << numKeys << " keys: "
+					  << "pointer walk " << double(walkMicros) / times.size() << "us, "
+					  << "getValueAtTimeInMillis " << double(trackMicros) / times.size() << "us per sample";
+	}
+	
+	//the playback times again as one buffer, the way previews and exports ask for them
+	vector<float> walked(playbackTimes.size());
+	vector<float> ranged(playbackTimes.size());
+	PointerWalk walk;
+	walk.keyframes = &keyframes;
+	walk.lastKeyframeIndex = 1;
+	walk.lastSampleTime = 0;
+	for(int i = 0; i < playbackTimes.size(); i++){
+		walked[i] = walk.sample(playbackTimes[i]);
+	}
+	unsigned long long rangeStart = ofGetElapsedTimeMicros();
+	track.sampleRange(0, playbackTimes.back(), ranged.size(), &ranged[0]);
+	unsigned long long rangeMicros = ofGetElapsedTimeMicros() - rangeStart;
+	int mismatches = 0;
+	for(int i = 0; i < playbackTimes.size(); i++){
+		if(walked[i] != ranged[i]){
+			if(mismatches == 0){
+				ofLogError() << "sampleRange differs at " << playbackTimes[i] << "ms: " << walked[i] << " walked, " << ranged[i] << " from the track";
+			}
+			mismatches++;
+		}
+	}
+	failures += mismatches;
+	ofLogNotice() << "sampleRange, " << ranged.size() << " samples: " << double(rangeMicros) / ranged.size() << "us per sample";
+	
+	if(failures > 0){
+		ofLogError() << failures << " samples differ";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,139 @@
+/**
+ * lfo fast evaluation test
+ * ofxTimeline
+ *
+ * samples LFO tracks with every kind of key and segment through the phase accumulator
+ * fast path and through the per sample math it replaces, checks they agree and times both
+ */
+
+#include "ofMain.h"
+#include "ofxTimeline.h"
+#include "ofxTLLFO.h"
+
+//lets the test set a long duration without calling setup, which needs a window
+class TestTimeline : public ofxTimeline {
+  public:
+	void setDuration(float seconds){
+		durationInSeconds = seconds;
+	}
+};
+
+//adds keys with the settings the test hands it and samples the store through the direct path
+class TestLFO : public ofxTLLFO {
+  public:
+	ofxTLLFOKey* addKey(unsigned long long millis, ofxTLLFOType type, float frequency, bool interpolate, bool expInterpolate){
+		addKeyframeAtMillis(millis);
+		ofxTLLFOKey* key = (ofxTLLFOKey*)keyframes.back();
+		key->type = type;
+		key->frequency = frequency;
+		key->interpolate = interpolate;
+		key->expInterpolate = expInterpolate;
+		key->amplitude = .8;
+		key->phaseShift = millis % 1000;
+		key->seed = millis % 7;
+		//the store copied the key before we changed it
+		keyStoreIsDirty = true;
+		return key;
+	}
+
+	void sampleDirect(unsigned long long startMillis, unsigned long long endMillis, int count, float* out, bool tableNoise){
+		sampleStoreRangeDirect((ofxTLLFOStore&)getKeyStore(), startMillis, endMillis, count, out, tableNoise);
+	}
+};
+
+int failures = 0;
+
+void expect(bool condition, string message){
+	if(!condition){
+		ofLogError() << message;
+		failures++;
+	}
+}
+
+float maxDifference(vector<float>& a, vector<float>& b){
+	float difference = 0;
+	for(int i = 0; i < a.size(); i++){
+		difference = MAX(difference, fabs(a[i] - b[i]));
+	}
+	return difference;
+}
+
+int main(){
+	TestTimeline timeline;
+	timeline.setAutosave(false);
+	timeline.enableUndo(false);
+	timeline.setDuration(10*60);
+	unsigned long long duration = timeline.getDurationInMilliseconds();
+
+	//held sines, a linear chirp, an exponential chirp and sines after the last key
+	TestLFO sines;
+	sines.setTimeline(&timeline);
+	sines.addKey(20000, OFXTL_LFO_TYPE_SINE, 120, false, false);
+	sines.addKey(90000, OFXTL_LFO_TYPE_SINE, 60, true, false);
+	sines.addKey(200000, OFXTL_LFO_TYPE_SINE, 600, true, true);
+	sines.addKey(330000, OFXTL_LFO_TYPE_SINE, 1200, false, false);
+	sines.addKey(450000, OFXTL_LFO_TYPE_SINE, 45, false, false);
+
+	//held and interpolated noise, and blends between noise and sine keys
+	TestLFO noise;
+	noise.setTimeline(&timeline);
+	noise.addKey(20000, OFXTL_LFO_TYPE_NOISE, 300, false, false);
+	noise.addKey(90000, OFXTL_LFO_TYPE_NOISE, 100, true, false);
+	noise.addKey(200000, OFXTL_LFO_TYPE_NOISE, 900, true, false);
+	noise.addKey(330000, OFXTL_LFO_TYPE_SINE, 200, true, false);
+	noise.addKey(450000, OFXTL_LFO_TYPE_NOISE, 50, false, false);
+
+	//one sample every millisecond like a bake at 1khz, and a coarser preview-like pass
+	int counts[] = { duration + 1, 1777 };
+	TestLFO* tracks[] = { &sines, &noise };
+	string trackNames[] = { "sines", "noise" };
+	for(int t = 0; t < 2; t++){
+		TestLFO& track = *tracks[t];
+		for(int c = 0; c < 2; c++){
+			int count = counts[c];
+			vector<float> direct(count), directTable(count), fast(count);
+
+			track.setUseFastEvaluation(false);
+			unsigned long long directStart = ofGetElapsedTimeMicros();
+			track.sampleRange(0, duration, count, &direct[0]);
+			unsigned long long directMicros = ofGetElapsedTimeMicros() - directStart;
+			track.sampleDirect(0, duration, count, &directTable[0], true);
+			expect(track.getFastEvaluationError(0, duration, count) < 1e-5, trackNames[t] + " getFastEvaluationError with fast evaluation off is " + ofToString(track.getFastEvaluationError(0, duration, count)));
+			expect(!track.getUseFastEvaluation(), "getFastEvaluationError turned fast evaluation on");
+
+			track.setUseFastEvaluation(true);
+			unsigned long long fastStart = ofGetElapsedTimeMicros();
+			track.sampleRange(0, duration, count, &fast[0]);
+			unsigned long long fastMicros = ofGetElapsedTimeMicros() - fastStart;
+			expect(track.getFastEvaluationError(0, duration, count) < 1e-5, trackNames[t] + " getFastEvaluationError with fast evaluation on is " + ofToString(track.getFastEvaluationError(0, duration, count)));
+			expect(track.getUseFastEvaluation(), "getFastEvaluationError turned fast evaluation off");
+
+			//the noise has to come from the table on both sides, ofSignedNoise is a different noise
+			float accumulatorError = maxDifference(fast, directTable);
+			expect(accumulatorError < 1e-5, trackNames[t] + ", " + ofToString(count) + " samples: the fast path is " + ofToString(accumulatorError) + " away from the per sample math");
+			if(t == 0){
+				float sineError = maxDifference(fast, direct);
+				expect(sineError < 1e-5, "sines, " + ofToString(count) + " samples: the fast path is " + ofToString(sineError) + " away from fast evaluation off");
+			}
+
+			//single samples read the same store, so they land on the same values
+			ofxTLKeyframeCursor cursor;
+			vector<float> single(count);
+			for(int i = 0; i < count; i++){
+				single[i] = track.getValueAtTimeInMillis(double(duration) * i / (count-1), cursor);
+			}
+			float singleError = maxDifference(fast, single);
+			expect(singleError < 1e-5, trackNames[t] + ", " + ofToString(count) + " samples: single samples are " + ofToString(singleError) + " away from the fast range");
+
+			ofLogNotice() << trackNames[t] << ", " << count << " samples: per sample " << double(directMicros) / count << "us, "
+						  << "fast " << double(fastMicros) / count << "us per sample, largest difference " << accumulatorError;
+		}
+	}
+
+	if(failures > 0){
+		ofLogError() << failures << " checks failed";
+		return 1;
+	}
+	ofLogNotice() << "the LFO fast path matches the per sample math";
+	return 0;
+}